@@ -0,0 +1,175 @@
+/*
+ * Centroid decomposition of a tree.
+ * Removing a centroid splits its component into parts of at most half the
+ * size, so every node has O(lg n) centroid ancestors, and every tree path
+ * passes through the lowest common centroid ancestor of its endpoints.
+ * Built in O(n lg n) time and memory, non-recursively, in flat arrays.
+ *
+ * Distance aggregates store one value per centroid c, combining dist(u, c)
+ * over the marked nodes u in c's component. Updates and queries at v then
+ * touch only the O(lg n) centroid ancestors of v; see ancestors().
+ *
+ * adj := undirected adjacency lists, e.g. graph::adj
+ * parent := parent in the centroid tree, or -1 for the top centroid
+ * level := depth in the centroid tree
+ * dist[k*n + v] := tree distance from v to its centroid ancestor at level k
+ */
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cassert>
+using namespace std;
+
+struct centroid_tree {
+    int n;
+    vector<int> parent, level, dist;
+
+    centroid_tree(const vector<vector<int>>& adj)
+        : n(adj.size()), parent(n, -1), level(n)
+    {
+        // todo := components left to split, as (any node, parent centroid)
+        // order := BFS order of the current component
+        // up := BFS parent in the current component
+        // size := subtree size in the current component
+        vector<bool> removed(n);
+        vector<int> order, up(n), size(n);
+        vector<pair<int,int>> todo;
+        if (n)
+            todo.emplace_back(0, -1);
+
+        auto bfs = [&](int s) {
+            order.assign(1, s);
+            up[s] = -1;
+            for (int i = 0; i < (int) order.size(); ++i)
+                for (auto nbr : adj[order[i]])
+                    if (!removed[nbr] && nbr != up[order[i]])
+                        up[nbr] = order[i], order.push_back(nbr);
+        };
+
+        while (!todo.empty()) {
+            int s = todo.back().first, p = todo.back().second;
+            todo.pop_back();
+
+            bfs(s);
+            int total = order.size(), c = s;
+            for (int i = total - 1; i >= 0; --i) {
+                int x = order[i];
+                size[x] = 1;
+                int biggest = 0;
+                for (auto nbr : adj[x])
+                    if (!removed[nbr] && nbr != up[x])
+                        size[x] += size[nbr], biggest = max(biggest, size[nbr]);
+                if (2 * max(biggest, total - size[x]) <= total)
+                    c = x;
+            }
+
+            parent[c] = p;
+            level[c] = p == -1 ? 0 : level[p] + 1;
+            if ((int) dist.size() < (level[c] + 1) * n)
+                dist.resize((level[c] + 1) * n);
+            int* d = &dist[level[c] * n];
+            bfs(c);
+            for (auto x : order)
+                d[x] = x == c ? 0 : d[up[x]] + 1;
+
+            removed[c] = true;
+            for (auto nbr : adj[c])
+                if (!removed[nbr])
+                    todo.emplace_back(nbr, c);
+        }
+    }
+
+    // Calls f(c, d) for each centroid ancestor c of v, from v itself up,
+    // where d is the tree distance from v to c.
+    template <typename F>
+    void ancestors(int v, F f) const {
+        for (int c = v; c != -1; c = parent[c])
+            f(c, dist[level[c] * n + v]);
+    }
+};
+
+int main() {
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 200;
+        vector<vector<int>> adj(n);
+        for (int i = 1; i < n; ++i) {
+            int p = t % 2 ? i - 1 : rand() % i;
+            adj[p].push_back(i);
+            adj[i].push_back(p);
+        }
+        centroid_tree ct(adj);
+
+        // Brute force all-pairs distances.
+        vector<vector<int>> dist(n, vector<int>(n, -1));
+        for (int s = 0; s < n; ++s) {
+            vector<int> q = {s};
+            dist[s][s] = 0;
+            for (int i = 0; i < (int) q.size(); ++i)
+                for (auto nbr : adj[q[i]])
+                    if (dist[s][nbr] == -1)
+                        dist[s][nbr] = dist[s][q[i]] + 1, q.push_back(nbr);
+        }
+
+        int log = 0;
+        while (1 << log <= n)
+            ++log;
+        for (int v = 0; v < n; ++v) {
+            assert(ct.level[v] < log);
+            ct.ancestors(v, [&](int c, int d) { assert(dist[v][c] == d); });
+        }
+
+        // Closest marked node: best[c] := min dist(u, c) over marked u.
+        const int none = 1 << 29;
+        vector<int> best(n, none);
+        vector<bool> marked(n);
+        for (int q = 0; q < 200; ++q) {
+            int v = rand() % n;
+            if (rand() % 2) {
+                marked[v] = true;
+                ct.ancestors(v, [&](int c, int d) { best[c] = min(best[c], d); });
+            } else {
+                int res = none, expected = none;
+                ct.ancestors(v, [&](int c, int d) { res = min(res, best[c] + d); });
+                for (int u = 0; u < n; ++u)
+                    if (marked[u])
+                        expected = min(expected, dist[v][u]);
+                assert(res == expected);
+            }
+        }
+
+        // Pairs at distance <= k: count pairs through each centroid, less
+        // pairs that stay inside one child component.
+        // within[c], below[c] := distances of c's component to c, parent[c]
+        int k = rand() % n;
+        vector<vector<int>> within(n), below(n);
+        for (int v = 0; v < n; ++v) {
+            int prev = -1;
+            ct.ancestors(v, [&](int c, int d) {
+                within[c].push_back(d);
+                if (prev != -1)
+                    below[prev].push_back(d);
+                prev = c;
+            });
+        }
+        auto pairs = [&](vector<int>& ds) {
+            sort(ds.begin(), ds.end());
+            long long res = 0;
+            for (int i = 0, j = ds.size() - 1; i < j; ++i) {
+                while (i < j && ds[i] + ds[j] > k)
+                    --j;
+                res += j - i;
+            }
+            return res;
+        };
+        long long res = 0, expected = 0;
+        for (int c = 0; c < n; ++c)
+            res += pairs(within[c]) - pairs(below[c]);
+        for (int u = 0; u < n; ++u)
+            for (int v = u + 1; v < n; ++v)
+                expected += dist[u][v] <= k;
+        assert(res == expected);
+    }
+
+    cout << "All tests passed" << endl;
+    return 0;
+}
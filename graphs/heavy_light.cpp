@@ -0,0 +1,266 @@
+/*
+ * Heavy-light decomposition of a rooted tree.
+ * Lays out nodes so that every heavy path, and every subtree, is a
+ * contiguous range of positions. Any root-to-node path crosses O(lg n)
+ * heavy paths, so path queries and updates on a segment tree over the
+ * positions cost O(lg^2 n). Construction is O(n) and non-recursive.
+ *
+ * children := child lists, e.g. graph::dfs_tree(root).adj
+ * parent := parent node, or -1 for the root
+ * heavy := child with the largest subtree, or -1 for a leaf
+ * head := topmost node on the heavy path through a node
+ * pos := position of a node in the layout
+ * size := number of nodes in a subtree
+ */
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cassert>
+using namespace std;
+using ll = long long;
+
+struct heavy_light {
+    int n;
+    vector<int> parent, depth, heavy, head, pos, size;
+
+    heavy_light(const vector<vector<int>>& children, int root)
+        : n(children.size()), parent(n, -1), depth(n), heavy(n, -1),
+          head(n), pos(n), size(n, 1)
+    {
+        // BFS order, so children come after their parents.
+        vector<int> order = {root};
+        for (int i = 0; i < (int) order.size(); ++i) {
+            int x = order[i];
+            for (auto c : children[x]) {
+                parent[c] = x;
+                depth[c] = depth[x] + 1;
+                order.push_back(c);
+            }
+        }
+        for (int i = order.size() - 1; i > 0; --i) {
+            int x = order[i], p = parent[x];
+            size[p] += size[x];
+            if (heavy[p] == -1 || size[x] > size[heavy[p]])
+                heavy[p] = x;
+        }
+
+        // Walk each heavy path top-down, stacking light children. Light
+        // children of deeper nodes are popped, and laid out, first.
+        vector<int> stack = {root};
+        int next = 0;
+        while (!stack.empty()) {
+            int h = stack.back();
+            stack.pop_back();
+            for (int x = h; x != -1; x = heavy[x]) {
+                head[x] = h;
+                pos[x] = next++;
+                for (auto c : children[x])
+                    if (c != heavy[x])
+                        stack.push_back(c);
+            }
+        }
+    }
+
+    int lca(int u, int v) const {
+        for (; head[u] != head[v]; u = parent[head[u]])
+            if (depth[head[u]] < depth[head[v]])
+                swap(u, v);
+        return depth[u] < depth[v] ? u : v;
+    }
+
+    // Calls f(l, r) for each of the O(lg n) position ranges [l,r] that
+    // together cover the path from u to v. Ranges come in no particular
+    // order, so f should apply a commutative operation. With edges = true
+    // the lca is skipped, for trees that store edge values at the child.
+    template <typename F>
+    void path(int u, int v, F f, bool edges = false) const {
+        for (; head[u] != head[v]; u = parent[head[u]]) {
+            if (depth[head[u]] < depth[head[v]])
+                swap(u, v);
+            f(pos[head[u]], pos[u]);
+        }
+        if (depth[u] > depth[v])
+            swap(u, v);
+        if (pos[u] + edges <= pos[v])
+            f(pos[u] + edges, pos[v]);
+    }
+
+    // Position range [l,r] of the subtree rooted at v.
+    pair<int,int> subtree(int v) const {
+        return make_pair(pos[v], pos[v] + size[v] - 1);
+    }
+};
+
+// Copied from data-structures/seg_tree_lazy.cpp.
+template <typename Monoid>
+struct seg_tree_lazy {
+    using T = typename Monoid::T;
+    using Update = typename Monoid::update;
+    Monoid m;
+    int s, h;
+    vector<T> v;
+    vector<Update> lazy;
+
+    seg_tree_lazy(int n, Monoid m = Monoid()): m(m) {
+        for (s = 1, h = 1; s < n; )
+            s <<= 1, ++h;
+        v.resize(2*s, T(m.id));
+        lazy.resize(s);
+    }
+
+    void apply(int i, int d, const Update& u) {
+        v[i] = u.apply(v[i], d);
+        if (i < s) {
+            lazy[i] = u.compose(lazy[i]);
+        }
+    }
+
+    void push(int i) {
+        for (int d = h; d > 0; --d) {
+            int l = i >> d;
+            if (lazy[l]) {
+                apply(2*l,   d-1, lazy[l]);
+                apply(2*l+1, d-1, lazy[l]);
+                lazy[l] = Update();
+            }
+        }
+    }
+
+    void pull(int i) {
+        for (int d = 1; d <= h; ++d) {
+            int l = i >> d;
+            T combined = m.op(v[2*l], v[2*l+1]);
+            v[l] = lazy[l].apply(combined, d);
+        }
+    }
+
+    void update(int i, int j, const Update& u) {
+        i += s, j += s;
+        push(i), push(j);
+        for (int l = i, r = j, d = 0; l <= r; l /= 2, r /= 2, ++d) {
+            if (l % 2 == 1) apply(l++, d, u);
+            if (r % 2 == 0) apply(r--, d, u);
+        }
+        pull(i), pull(j);
+    }
+
+    T query(int i, int j) {
+        i += s, j += s;
+        push(i), push(j);
+        T l = m.id, r = m.id;
+        for (; i <= j; i /= 2, j /= 2) {
+            if (i % 2 == 1) l = m.op(l, v[i++]);
+            if (j % 2 == 0) r = m.op(v[j--], r);
+        }
+        return m.op(l, r);
+    }
+};
+
+// Range sum with range add.
+struct sum_monoid {
+    using T = ll;
+    static constexpr T id = 0;
+    static T op(T a, T b) { return a + b; }
+
+    struct update {
+        T x;
+        update(T x = 0): x(x) {}
+        explicit operator bool() const { return x != 0; }
+        T apply(T n, int d) const { return n + x * (1ll << d); }
+        update compose(const update& other) const { return x + other.x; }
+    };
+};
+
+int main() {
+    for (int t = 0; t < 200; ++t) {
+        int n = 1 + rand() % 100, root = rand() % n;
+        vector<int> parent(n, -1);
+        vector<vector<int>> children(n);
+
+        // Random tree, or a random path when t is odd.
+        vector<int> order = {root};
+        for (int i = 0; i < n; ++i)
+            if (i != root)
+                order.push_back(i);
+        for (int i = 2; i < n; ++i)
+            swap(order[i], order[1 + rand() % i]);
+        for (int i = 1; i < n; ++i) {
+            int p = order[t % 2 ? i - 1 : rand() % i];
+            parent[order[i]] = p;
+            children[p].push_back(order[i]);
+        }
+
+        heavy_light h(children, root);
+        seg_tree_lazy<sum_monoid> s(n);
+        vector<ll> v(n);
+        auto on_path = [&](int u, int w) {
+            vector<int> nodes;
+            while (u != w) {
+                if (h.depth[u] < h.depth[w])
+                    swap(u, w);
+                nodes.push_back(u);
+                u = parent[u];
+            }
+            nodes.push_back(u);
+            return nodes;
+        };
+        auto in_subtree = [&](int x, int r) {
+            for (; x != -1; x = parent[x])
+                if (x == r)
+                    return true;
+            return false;
+        };
+
+        for (int q = 0; q < 300; ++q) {
+            int u = rand() % n, w = rand() % n, x = rand() % 100;
+            auto nodes = on_path(u, w);
+            assert(h.lca(u, w) == nodes.back());
+            switch (rand() % 4) {
+            case 0:
+                for (auto y : nodes)
+                    v[y] += x;
+                h.path(u, w, [&](int l, int r) { s.update(l, r, x); });
+                break;
+            case 1: {
+                ll sum = 0, expected = 0;
+                for (auto y : nodes)
+                    expected += v[y];
+                h.path(u, w, [&](int l, int r) { sum += s.query(l, r); });
+                assert(sum == expected);
+                sum = 0;
+                h.path(u, w, [&](int l, int r) { sum += s.query(l, r); }, true);
+                assert(sum == expected - v[nodes.back()]);
+                break;
+            }
+            case 2:
+                for (int y = 0; y < n; ++y)
+                    if (in_subtree(y, u))
+                        v[y] += x;
+                s.update(h.subtree(u).first, h.subtree(u).second, x);
+                break;
+            case 3: {
+                ll expected = 0;
+                for (int y = 0; y < n; ++y)
+                    if (in_subtree(y, u))
+                        expected += v[y];
+                assert(s.query(h.subtree(u).first, h.subtree(u).second) == expected);
+                break;
+            }
+            }
+        }
+    }
+
+    // Deep trees do not overflow the stack.
+    int n = 1000000;
+    vector<vector<int>> chain(n);
+    for (int i = 0; i + 1 < n; ++i)
+        chain[i].push_back(i + 1);
+    heavy_light h(chain, 0);
+    assert(h.lca(n - 1, n / 2) == n / 2);
+    int ranges = 0;
+    h.path(0, n - 1, [&](int, int) { ++ranges; });
+    assert(ranges == 1);
+
+    cout << "All tests passed" << endl;
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Rerooting DP: the answer of a tree DP for every choice of root, in O(n)
+ * total instead of one O(n) traversal per root. Two non-recursive passes:
+ * the first computes each subtree summary bottom-up; the second pushes the
+ * summary of "everything above v" down to each child, combining its
+ * siblings with prefix and suffix merges, so merge need not be invertible.
+ *
+ * children := child lists, e.g. graph::dfs_tree(root).adj
+ * down[v] := summary of v's subtree, rooted at root
+ * up[v] := contribution of the rest of the tree to v, as a lifted child
+ *
+ * M must provide:
+ * T := summary of a rooted subtree
+ * id := identity for merge
+ * merge(a, b) := associative combination of child contributions
+ * lift(a, c, p) := contribution of a subtree rooted at c, with summary a,
+ *                  when hung below node p (e.g. adds the edge c-p)
+ * finish(a, v) := summary of a subtree rooted at v whose children merge
+ *                 to a
+ *
+ * Returns finish of the full merge at v, i.e. the DP rooted at v, for
+ * every v.
+ */
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cassert>
+using namespace std;
+using ll = long long;
+
+template <typename M>
+vector<typename M::T>
+reroot(const vector<vector<int>>& children, int root, M m = M()) {
+    using T = typename M::T;
+    int n = children.size();
+    vector<int> order = {root};
+    for (int i = 0; i < (int) order.size(); ++i)
+        for (auto c : children[order[i]])
+            order.push_back(c);
+
+    vector<T> down(n, m.id), up(n, m.id), res(n, m.id);
+    for (int i = n - 1; i >= 0; --i) {
+        int v = order[i];
+        T acc = m.id;
+        for (auto c : children[v])
+            acc = m.merge(acc, m.lift(down[c], c, v));
+        down[v] = m.finish(acc, v);
+    }
+
+    // suffix[i] := merge of the lifted children i.. of the current node
+    vector<T> suffix;
+    for (auto v : order) {
+        const auto& cs = children[v];
+        int k = cs.size();
+        suffix.assign(k + 1, m.id);
+        for (int i = k - 1; i >= 0; --i)
+            suffix[i] = m.merge(m.lift(down[cs[i]], cs[i], v), suffix[i + 1]);
+        T prefix = v == root ? m.id : up[v];
+        res[v] = m.finish(m.merge(prefix, suffix[0]), v);
+        for (int i = 0; i < k; ++i) {
+            int c = cs[i];
+            up[c] = m.lift(m.finish(m.merge(prefix, suffix[i + 1]), v), v, c);
+            prefix = m.merge(prefix, m.lift(down[c], c, v));
+        }
+    }
+    return res;
+}
+
+// Sum of distances to every other node: (nodes, total distance).
+struct distance_sum {
+    using T = pair<ll, ll>;
+    T id = T(0, 0);
+    T merge(T a, T b) const { return T(a.first + b.first, a.second + b.second); }
+    T lift(T a, int, int) const { return T(a.first, a.second + a.first); }
+    T finish(T a, int) const { return T(a.first + 1, a.second); }
+};
+
+// Distance to the farthest node, with weighted edges.
+// w[c] := weight of the edge from c to its parent in the input tree
+struct eccentricity {
+    using T = ll;
+    const vector<int>& parent;
+    const vector<ll>& w;
+    T id = 0;
+    T merge(T a, T b) const { return max(a, b); }
+    T lift(T a, int c, int p) const { return a + (parent[c] == p ? w[c] : w[p]); }
+    T finish(T a, int) const { return a; }
+};
+
+int main() {
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 100, root = rand() % n;
+        vector<int> parent(n, -1);
+        vector<ll> w(n);
+        vector<vector<int>> children(n);
+        vector<vector<pair<int,ll>>> adj(n);
+        vector<int> order = {root};
+        for (int i = 0; i < n; ++i)
+            if (i != root)
+                order.push_back(i);
+        for (int i = 2; i < n; ++i)
+            swap(order[i], order[1 + rand() % i]);
+        for (int i = 1; i < n; ++i) {
+            int c = order[i], p = order[t % 2 ? i - 1 : rand() % i];
+            parent[c] = p;
+            w[c] = rand() % 100;
+            children[p].push_back(c);
+            adj[p].emplace_back(c, w[c]);
+            adj[c].emplace_back(p, w[c]);
+        }
+
+        auto sums = reroot<distance_sum>(children, root);
+        auto far = reroot(children, root, eccentricity{parent, w});
+        for (int s = 0; s < n; ++s) {
+            // Brute force: one traversal per root.
+            vector<ll> hops(n, -1), dist(n);
+            vector<int> q = {s};
+            hops[s] = 0;
+            for (int i = 0; i < (int) q.size(); ++i)
+                for (auto e : adj[q[i]])
+                    if (hops[e.first] == -1) {
+                        hops[e.first] = hops[q[i]] + 1;
+                        dist[e.first] = dist[q[i]] + e.second;
+                        q.push_back(e.first);
+                    }
+            ll total = 0;
+            for (auto h : hops)
+                total += h;
+            assert(sums[s] == make_pair(ll(n), total));
+            assert(far[s] == *max_element(dist.begin(), dist.end()));
+        }
+    }
+
+    // Deep trees do not overflow the stack.
+    int n = 1000000;
+    vector<vector<int>> chain(n);
+    for (int i = 0; i + 1 < n; ++i)
+        chain[i].push_back(i + 1);
+    auto sums = reroot<distance_sum>(chain, 0);
+    assert(sums[0].second == ll(n) * (n - 1) / 2);
+    assert(sums[n / 2].second == ll(n / 2) * (n / 2));
+
+    cout << "All tests passed" << endl;
+    return 0;
+}
@@ -9,66 +9,836 @@
  * Dijkstra: ~ O(E log V)
  * - returns distances from a source node s to every other
  * - negative edges not supported
+ * - the priority queue is a template argument: binary_heap (default),
+ *   quad_heap (indexed 4-ary heap with decrease-key, O(V) entries), or for
+ *   integer weights radix_heap (O(E + V log C)) and bucket_queue (Dial's
+ *   algorithm, O(E + V C)), where C is the largest weight
+ *
+ * Dijkstra with a dijkstra_workspace: O(what it touches) per query
+ * - the workspace owns dist, prev and the heap, reset lazily by a
+ *   generation stamp rather than O(V) per query
+ * - starts from one node or many at distance 0, and settles only nodes
+ *   within an optional distance bound, stopping early at a target
+ * - allow(x, y) can mask arcs x -> y and nodes, without copying the graph
+ *
+ * Yen's K shortest loopless paths: O(K V (E + V log V))
+ * - returns up to K (cost, path) from s to t, cheapest first, no node
+ *   repeated within a path; each spur search reuses one workspace
+ *
+ * Point-to-point: shortest_path(s, t) returns (distance, path from s to t)
+ * - plain: Dijkstra that stops once t is settled
+ * - bidirectional: given the reverse graph (e.g. reversed(), or the graph
+ *   itself if undirected), alternates forward and backward searches and
+ *   stops once the two heap minima sum to at least the best s-t path seen
+ * - a_star(s, t, h): Dijkstra on keys dist + h(x), which settles each node
+ *   once if h is consistent, i.e. h(t) = 0 and h(x) <= w(x, y) + h(y)
+ * - unreachable t gives (infty, {})
  *
  * Bellman-Ford: ~ O(VE)
  * - returns distances from a source node s to every other
  * - supports negative edges
  *
+ * SPFA: O(VE) worst case, usually near O(E)
+ * - Bellman-Ford relaxing only arcs out of nodes whose distance changed,
+ *   stopping as soon as distances converge
+ * - small label first: a node goes to the front of the queue if its
+ *   distance beats the current front
+ * - returns a negative cycle reachable from s, as its nodes in arc order;
+ *   s = -1 starts every node at 0, as from a virtual source
+ *
  * Floyd-Warshall: O(V^3)
  * - returns distances between every pair of nodes
  * - supports negative edges
+ * - blocked_floyd_warshall, opt-in, works on flat 64-byte aligned
+ *   matrices in cache-sized tiles, with a branch-free inner loop that
+ *   vectorizes, running the independent tiles of each phase on parallel
+ *   threads; it needs the sum over nodes of their largest |out-arc
+ *   weight| below infty / 4, which bounds every |path length|
+ * - next[i][j] := first node after i on a shortest path to j, or -1
  *
  * Johnson's Algorithm: ~ O(V^2 log V + VE)
  * - returns distances between every pair of nodes
  * - better than Floyd-Warshall for sparse graphs with negative edges
+ * - parallel_johnsons reweights once into a csr_graph, then runs the n
+ *   Dijkstras on a pool of threads, each reusing its own heap and done
+ *   array and writing straight into rows of flat n x n matrices
+ *
+ * DAG shortest/longest paths: O(V + E)
+ * - returns distances from a source node s to every other
+ * - supports negative edges; the graph must be acyclic
+ * - built on dag_dp, which visits arcs in topological order
  *
  * Mst:
  * - returns the weight of the minimum spanning tree
+ * - lazy Prim from node 0; the graph must be connected
+ *
+ * Kruskal: O(E lg E), O(E) for integer weights
+ * - returns the edges (x, y, w) of a minimum spanning forest
+ * - each arc is an edge, so undirected edges may be stored twice
+ * - integer weights are radix sorted, others use sort
+ *
+ * Boruvka: O(E lg V / threads + V lg V)
+ * - returns the edges of a minimum spanning forest, like Kruskal
+ * - each round every component picks its lightest outgoing edge, ties
+ *   broken by arc index so no cycle forms; the edge scan runs in parallel
+ *
+ * Relabeling: O(V + E lg E)
+ * - vertex_order gives BFS, reverse Cuthill-McKee, or degree order
+ * - relabel copies the graph with node x renamed forward[x], so the
+ *   algorithms above touch nearby memory; map results back by backward
+ *
+ * graph<T> stores adjacency lists. csr_graph<T> is an immutable copy in
+ * compressed sparse rows. mapped_graph<T> is a read-only view of a binary
+ * graph file, loaded with mmap. All algorithms accept any of them.
  */
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <vector>
+#include <algorithm>
 #include <queue>
+#include <deque>
+#include <set>
 #include <stack>
 #include <tuple>
+#include <type_traits>
+#include <limits>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <cassert>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
 template <typename T>
-struct graph {
-    int n;
-    vector<vector<pair<int,T>>> adj;
+struct graph;
+
+template <typename T>
+struct csr_graph;
+
+enum class ordering { bfs, rcm, degree };
+
+// A relabeled copy of a graph.
+// forward[x] := new id of old node x
+// backward[y] := old id of new node y
+template <typename Graph>
+struct relabeled {
+    Graph g;
+    vector<int> forward, backward;
+};
+
+// Priority queues for dijkstra. push(x, d) records tentative distance d of
+// node x, lower than any earlier one; pop() removes and returns a (d, x)
+// with minimum d. Queues with lazy deletion may return stale entries,
+// which dijkstra skips. Keys popped never decrease, which the monotone
+// integer queues rely on. bounded queues are built with the largest arc
+// weight, the others ignore it.
+
+// Lazy-deletion binary heap; holds up to one entry per relaxed arc.
+template <typename T>
+struct binary_heap {
+    static constexpr bool bounded = false;
+    priority_queue<pair<T,int>, vector<pair<T,int>>, greater<pair<T,int>>> q;
+
+    binary_heap(int, T) {}
+    bool empty() const { return q.empty(); }
+    void push(int x, T d) { q.emplace(d, x); }
+    pair<T,int> pop() { auto top = q.top(); q.pop(); return top; }
+};
+
+// Indexed 4-ary heap with decrease-key; holds each node at most once.
+// pos[x] := index of x in heap, or -1
+template <typename T>
+struct quad_heap {
+    static constexpr bool bounded = false;
+    vector<int> heap, pos;
+    vector<T> key;
+
+    quad_heap(int n, T): pos(n, -1), key(n) {}
+    bool empty() const { return heap.empty(); }
+
+    void push(int x, T d) {
+        key[x] = d;
+        if (pos[x] == -1)
+            pos[x] = heap.size(), heap.push_back(x);
+        up(pos[x]);
+    }
+
+    pair<T,int> pop() {
+        int x = heap[0];
+        pos[x] = -1;
+        if (heap.size() > 1) {
+            heap[0] = heap.back();
+            pos[heap[0]] = 0;
+            heap.pop_back();
+            down(0);
+        } else {
+            heap.pop_back();
+        }
+        return make_pair(key[x], x);
+    }
+
+    void up(int i) {
+        int x = heap[i];
+        for (; i > 0 && key[x] < key[heap[(i-1) / 4]]; i = (i-1) / 4)
+            heap[i] = heap[(i-1) / 4], pos[heap[i]] = i;
+        heap[i] = x, pos[x] = i;
+    }
+
+    void down(int i) {
+        int x = heap[i], size = heap.size();
+        for (;;) {
+            int best = i, first = 4*i + 1;
+            T least = key[x];
+            for (int c = first; c < min(first + 4, size); ++c)
+                if (key[heap[c]] < least)
+                    best = c, least = key[heap[c]];
+            if (best == i)
+                break;
+            heap[i] = heap[best], pos[heap[i]] = i;
+            i = best;
+        }
+        heap[i] = x, pos[x] = i;
+    }
+};
+
+// Radix heap for non-negative integer keys. Bucket i holds keys whose
+// highest bit differing from the last popped key is bit i-1, so each entry
+// moves down at most once per bit.
+template <typename T>
+struct radix_heap {
+    static_assert(is_integral<T>::value, "radix_heap needs integer weights");
+    static constexpr bool bounded = false;
+    using U = typename make_unsigned<T>::type;
+    static constexpr int bits = 8 * sizeof(U);
+    vector<pair<U,int>> bucket[bits + 1];
+    U last = 0;
+    size_t size = 0;
+
+    radix_heap(int, T) {}
+    bool empty() const { return size == 0; }
+
+    static int index(U x) { return x ? 64 - __builtin_clzll(x) : 0; }
+
+    void push(int x, T d) {
+        assert(U(d) >= last);
+        bucket[index(U(d) ^ last)].emplace_back(d, x);
+        ++size;
+    }
+
+    pair<T,int> pop() {
+        if (bucket[0].empty()) {
+            int i = 1;
+            while (bucket[i].empty())
+                ++i;
+            last = min_element(bucket[i].begin(), bucket[i].end())->first;
+            for (auto& e : bucket[i])
+                bucket[index(e.first ^ last)].push_back(e);
+            bucket[i].clear();
+        }
+        auto e = bucket[0].back();
+        bucket[0].pop_back();
+        --size;
+        return make_pair(T(e.first), e.second);
+    }
+};
+
+// Dial's bucket queue for integer weights in [0, C]. Pending keys span
+// at most C + 1 values, so C + 1 circular buckets indexed by key suffice.
+template <typename T>
+struct bucket_queue {
+    static_assert(is_integral<T>::value, "bucket_queue needs integer weights");
+    static constexpr bool bounded = true;
+    vector<vector<int>> bucket;
+    T cur = 0;
+    size_t size = 0;
+
+    bucket_queue(int, T max_weight): bucket(max_weight + 1) {}
+    bool empty() const { return size == 0; }
+
+    void push(int x, T d) {
+        bucket[d % bucket.size()].push_back(x);
+        ++size;
+    }
+
+    pair<T,int> pop() {
+        while (bucket[cur % bucket.size()].empty())
+            ++cur;
+        auto& b = bucket[cur % bucket.size()];
+        int x = b.back();
+        b.pop_back();
+        --size;
+        return make_pair(cur, x);
+    }
+};
+
+template <typename U>
+struct aligned_allocator {
+    using value_type = U;
+    static constexpr align_val_t align{64};
+
+    aligned_allocator() = default;
+    template <typename V>
+    aligned_allocator(const aligned_allocator<V>&) {}
+
+    U* allocate(size_t k) { return static_cast<U*>(::operator new(k * sizeof(U), align)); }
+    void deallocate(U* p, size_t) { ::operator delete(p, align); }
+
+    template <typename V>
+    bool operator==(const aligned_allocator<V>&) const { return true; }
+    template <typename V>
+    bool operator!=(const aligned_allocator<V>&) const { return false; }
+};
+
+// Dense n x n matrix in one aligned allocation, row-major, with rows and
+// columns padded up to a multiple of block. m[i][j] is row i, column j.
+template <typename U>
+struct matrix {
+    int n, size;
+    vector<U, aligned_allocator<U>> v;
+
+    matrix(int n, U x, int block = 1)
+        : n(n), size((n + block - 1) / block * block), v(size_t(size) * size, x) {}
+
+    U* operator[](int i) { return &v[size_t(i) * size]; }
+    const U* operator[](int i) const { return &v[size_t(i) * size]; }
+};
+
+// Runs f(0), ..., f(threads - 1) on separate threads.
+template <typename F>
+void parallel_for(int threads, F f) {
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.emplace_back(f, t);
+    f(0);
+    for (auto& th : pool)
+        th.join();
+}
+
+// Copied from data-structures/union_find.cpp.
+struct union_find {
+    vector<int> p, s, r;
+    int c;
+
+    union_find(int n): p(n), s(n, 1), r(n), c(n) {
+        for (int i = 0; i < n; ++i) {
+            p[i] = i;
+        }
+    }
+
+    int rep(int i) {
+        return p[i] == i ? i : p[i] = rep(p[i]);
+    }
+
+    void merge(int a, int b) {
+        a = rep(a), b = rep(b);
+        if (a == b)
+            return;
+        if (r[a] > r[b])
+            swap(a, b);
+        p[a] = b;
+        s[b] += s[a];
+        if (r[a] == r[b])
+            ++r[b];
+        --c;
+    }
+};
+
+// Default arc filter for dijkstra with a workspace.
+struct any_arc {
+    bool operator()(int, int) const { return true; }
+};
+
+// Caller-owned state for repeated dijkstra queries. Entries are valid only
+// when stamped with the current generation, so each query starts by
+// bumping gen instead of clearing O(n) arrays.
+// settled := nodes settled by the last query, in order
+template <typename T>
+struct dijkstra_workspace {
     static constexpr T infty = numeric_limits<T>::max();
+    vector<T> d;
+    vector<int> p, seen, done, settled;
+    vector<pair<T,int>> q;
+    int gen = 0;
 
-    graph(int n): n(n), adj(n) {}
+    // Starts a new query on a graph with n nodes.
+    void reset(int n) {
+        if ((int) seen.size() < n) {
+            d.resize(n), p.resize(n);
+            seen.resize(n), done.resize(n);
+        }
+        if (++gen == numeric_limits<int>::max()) {
+            fill(seen.begin(), seen.end(), 0);
+            fill(done.begin(), done.end(), 0);
+            gen = 1;
+        }
+        settled.clear();
+        q.clear();
+    }
 
-    void arc (int i, int j, T w) { adj[i].emplace_back(j, w); }
-    void edge(int i, int j, T w) { arc(i, j, w), arc(j, i, w); }
+    T dist(int x) const { return seen[x] == gen ? d[x] : infty; }
+    int prev(int x) const { return seen[x] == gen ? p[x] : -1; }
+    bool reached(int x) const { return done[x] == gen; }
+};
+
+// G must provide n and nbrs(x), a range of (node, weight) pairs.
+template <typename T, typename G>
+struct graph_base {
+    static constexpr T infty = numeric_limits<T>::max();
 
+    const G& self() const { return static_cast<const G&>(*this); }
+
+    template <typename Queue = binary_heap<T>>
     pair<vector<T>, vector<int>>
     dijkstra(int s) const;
 
+    // Sources are [first, last), so no overload allocates per query.
+    template <typename Allow = any_arc>
+    void dijkstra(dijkstra_workspace<T>& w, const int* first, const int* last,
+                  T bound = infty, int target = -1, Allow allow = Allow()) const;
+
+    template <typename Allow = any_arc>
+    void dijkstra(dijkstra_workspace<T>& w, const vector<int>& sources,
+                  T bound = infty, int target = -1, Allow allow = Allow()) const {
+        dijkstra(w, sources.data(), sources.data() + sources.size(), bound, target, allow);
+    }
+
+    template <typename Allow = any_arc>
+    void dijkstra(dijkstra_workspace<T>& w, int s, T bound = infty,
+                  int target = -1, Allow allow = Allow()) const {
+        dijkstra(w, &s, &s + 1, bound, target, allow);
+    }
+
+    vector<pair<T, vector<int>>> k_shortest_paths(int s, int t, int k) const;
+
+    pair<T, vector<int>> shortest_path(int s, int t) const;
+
+    template <typename R>
+    pair<T, vector<int>> shortest_path(int s, int t, const R& reverse) const;
+
+    template <typename H>
+    pair<T, vector<int>> a_star(int s, int t, H h) const;
+
+    csr_graph<T> reversed() const;
+
     pair<vector<T>, vector<int>>
     bellman_ford(int s, bool* negative_cycle) const;
 
+    pair<vector<T>, vector<int>>
+    spfa(int s, vector<int>* negative_cycle) const;
+
     pair<vector<vector<T>>, vector<vector<int>>>
     floyd_warshall() const;
 
+    pair<matrix<T>, matrix<int>>
+    blocked_floyd_warshall(int threads = thread::hardware_concurrency()) const;
+
     pair<vector<vector<T>>, vector<vector<int>>>
     johnsons_algorithm(bool* negative_cycle) const;
 
+    pair<matrix<T>, matrix<int>>
+    parallel_johnsons(bool* negative_cycle,
+                      int threads = thread::hardware_concurrency()) const;
+
+    vector<vector<int>> topological_levels() const;
+
+    template <typename F>
+    bool dag_dp(F f) const;
+
+    template <typename Better>
+    pair<vector<T>, vector<int>>
+    dag_path(int s, T none, Better better) const;
+
+    pair<vector<T>, vector<int>>
+    dag_shortest_path(int s) const { return dag_path(s, infty, less<T>()); }
+
+    pair<vector<T>, vector<int>>
+    dag_longest_path(int s) const { return dag_path(s, -infty, greater<T>()); }
+
     T mst() const;
+
+    vector<tuple<int,int,T>> kruskal() const;
+
+    vector<tuple<int,int,T>>
+    boruvka(int threads = thread::hardware_concurrency()) const;
+
+    vector<int> vertex_order(ordering o) const;
+
+    relabeled<graph<T>> relabel(const vector<int>& backward) const;
+
+    relabeled<graph<T>> relabel(ordering o) const;
+};
+
+template <typename T>
+struct graph : graph_base<T, graph<T>> {
+    int n;
+    vector<vector<pair<int,T>>> adj;
+
+    graph(int n): n(n), adj(n) {}
+
+    void arc (int i, int j, T w) { adj[i].emplace_back(j, w); }
+    void edge(int i, int j, T w) { arc(i, j, w), arc(j, i, w); }
+
+    const vector<pair<int,T>>& nbrs(int x) const { return adj[x]; }
+};
+
+// Zips parallel target and weight arrays into a range of (node, weight).
+template <typename T>
+struct arc_range {
+    const int* to;
+    const T* w;
+    int len;
+
+    struct iterator {
+        const int* to;
+        const T* w;
+        pair<int,T> operator*() const { return make_pair(*to, *w); }
+        iterator& operator++() { ++to, ++w; return *this; }
+        bool operator!=(const iterator& other) const { return to != other.to; }
+    };
+
+    iterator begin() const { return {to, w}; }
+    iterator end() const { return {to + len, w + len}; }
+    int size() const { return len; }
+    pair<int,T> operator[](int i) const { return make_pair(to[i], w[i]); }
 };
 
+// Binary graph file: a graph_file_header, then int32 start[n+1] and
+// to[m] in compressed sparse row order, then zero padding to a multiple
+// of 8 bytes and m weights of weight_size bytes. Native byte order.
+// unweighted.cpp reads and writes the same format.
+struct graph_file_header {
+    char magic[8];
+    int64_t n, m;
+    int32_t weight_size, reserved;
+};
+
+const char graph_file_magic[8] = {'C','S','R','G','R','A','P','H'};
+
+// Writes g to path in the binary format. Returns false on failure.
+template <typename T>
+bool write_graph(const char* path, const graph<T>& g) {
+    vector<int> start(g.n + 1), to;
+    vector<T> w;
+    for (int i = 0; i < g.n; ++i) {
+        start[i+1] = start[i] + g.adj[i].size();
+        for (auto& p : g.adj[i])
+            to.push_back(p.first), w.push_back(p.second);
+    }
+    graph_file_header h = {{}, g.n, (int64_t) to.size(), sizeof(T), 0};
+    memcpy(h.magic, graph_file_magic, sizeof h.magic);
+    ofstream out(path, ios::binary);
+    out.write((const char*) &h, sizeof h);
+    out.write((const char*) start.data(), start.size() * sizeof(int));
+    out.write((const char*) to.data(), to.size() * sizeof(int));
+    char pad[8] = {};
+    out.write(pad, (8 - (start.size() + to.size()) * sizeof(int) % 8) % 8);
+    out.write((const char*) w.data(), w.size() * sizeof(T));
+    return bool(out.flush());
+}
+
+// Converts a text edge list, "n m" followed by m arcs "i j w", to a graph.
+// Write the result with write_graph to convert it to the binary format.
 template <typename T>
+graph<T> read_edge_list(istream& in) {
+    int n, i, j;
+    long long m;
+    T w;
+    in >> n >> m;
+    graph<T> g(n);
+    while (m-- > 0 && in >> i >> j >> w)
+        g.arc(i, j, w);
+    return g;
+}
+
+// Maps a binary graph file read-only, without copying or parsing. Pages
+// load lazily as algorithms touch them. Evaluates to false if the file is
+// missing, its header is malformed, or its weights are of a different
+// size than T. The arc arrays are trusted unless check is set, which
+// rejects a start that decreases or an arc outside [0, n) in O(n + m).
+template <typename T>
+struct mapped_graph : graph_base<T, mapped_graph<T>> {
+    int n = 0;
+    const int *start = nullptr, *to = nullptr;
+    const T* w = nullptr;
+    void* data = MAP_FAILED;
+    size_t bytes = 0;
+
+    mapped_graph(const char* path, bool check = false) {
+        int fd = open(path, O_RDONLY);
+        if (fd == -1)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(graph_file_header)) {
+            bytes = st.st_size;
+            data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (data == MAP_FAILED)
+            return;
+        // Header fields are untrusted: bound them by the file size with
+        // divisions, so a corrupt n or m cannot overflow the checks.
+        auto h = (const graph_file_header*) data;
+        size_t ints = (bytes - sizeof *h) / sizeof(int);
+        bool ok = !memcmp(h->magic, graph_file_magic, sizeof h->magic) &&
+                  h->n >= 0 && h->n < INT_MAX && h->m >= 0 && h->m <= INT_MAX &&
+                  h->weight_size == sizeof(T) &&
+                  size_t(h->n) + 1 <= ints && size_t(h->m) <= ints - (h->n + 1);
+        size_t arcs = ok ? sizeof *h + (h->n + 1 + h->m) * sizeof(int) : 0;
+        size_t weights = (arcs + 7) / 8 * 8;
+        start = (const int*) (h + 1);
+        if (!ok || weights > bytes || size_t(h->m) > (bytes - weights) / sizeof(T) ||
+            start[0] != 0 || start[h->n] != h->m) {
+            munmap(data, bytes);
+            data = MAP_FAILED;
+            start = nullptr;
+            return;
+        }
+        n = h->n;
+        to = start + n + 1;
+        w = (const T*) ((const char*) data + weights);
+        if (check && !valid_body()) {
+            munmap(data, bytes);
+            data = MAP_FAILED;
+            n = 0, start = to = nullptr, w = nullptr;
+        }
+    }
+
+    mapped_graph(const mapped_graph&) = delete;
+    mapped_graph& operator=(const mapped_graph&) = delete;
+
+    ~mapped_graph() {
+        if (data != MAP_FAILED)
+            munmap(data, bytes);
+    }
+
+    // Whether start is non-decreasing and every arc stays in [0, n).
+    bool valid_body() const {
+        for (int x = 0; x < n; ++x)
+            if (start[x] > start[x+1])
+                return false;
+        for (int i = 0; i < start[n]; ++i)
+            if (to[i] < 0 || to[i] >= n)
+                return false;
+        return true;
+    }
+
+    explicit operator bool() const { return data != MAP_FAILED; }
+
+    arc_range<T> nbrs(int x) const {
+        return {to + start[x], w + start[x], start[x+1] - start[x]};
+    }
+};
+
+// Compressed sparse rows: the arcs out of x are to[i], w[i] for i in
+// [start[x], start[x+1]). Copied from any graph in O(V + E).
+template <typename T>
+struct csr_graph : graph_base<T, csr_graph<T>> {
+    int n;
+    vector<int> start, to;
+    vector<T> w;
+
+    // Counting sort of (x, y, w) arcs by x. Arcs keep their input order.
+    csr_graph(int n, const vector<tuple<int,int,T>>& arcs)
+        : n(n), start(n + 1), to(arcs.size()), w(arcs.size())
+    {
+        for (auto& a : arcs)
+            ++start[get<0>(a) + 1];
+        for (int x = 0; x < n; ++x)
+            start[x+1] += start[x];
+        vector<int> fill(start.begin(), start.end() - 1);
+        for (auto& a : arcs) {
+            int i = fill[get<0>(a)]++;
+            to[i] = get<1>(a), w[i] = get<2>(a);
+        }
+    }
+
+    template <typename G>
+    csr_graph(const graph_base<T, G>& base): n(base.self().n), start(n + 1) {
+        const G& g = base.self();
+        for (int x = 0; x < n; ++x)
+            start[x+1] = start[x] + g.nbrs(x).size();
+        to.reserve(start[n]);
+        w.reserve(start[n]);
+        for (int x = 0; x < n; ++x)
+            for (auto p : g.nbrs(x))
+                to.push_back(p.first), w.push_back(p.second);
+    }
+
+    arc_range<T> nbrs(int x) const {
+        return {to.data() + start[x], w.data() + start[x], start[x+1] - start[x]};
+    }
+};
+
+template <typename T, typename G>
+template <typename Queue>
 pair<vector<T>, vector<int>>
-graph<T>::dijkstra(int s) const {
+graph_base<T, G>::dijkstra(int s) const {
+    const G& g = self();
+    const int n = g.n;
+    vector<T> dist(n, T(infty));
+    vector<int> prev(n, -1);
+    vector<bool> done(n);
+    T max_weight = 0;
+    if (Queue::bounded)
+        for (int x = 0; x < n; ++x)
+            for (auto p : g.nbrs(x))
+                max_weight = max(max_weight, p.second);
+    Queue q(n, max_weight);
+    q.push(s, 0);
+    dist[s] = 0;
+
+    while (!q.empty()) {
+        int x = q.pop().second;
+        if (done[x])
+            continue;
+        done[x] = true;
+        for (auto p : g.nbrs(x)) {
+            int c; T w;
+            tie(c, w) = p;
+            if (!done[c] && dist[c] > dist[x] + w) {
+                dist[c] = dist[x] + w;
+                prev[c] = x;
+                q.push(c, dist[c]);
+            }
+        }
+    }
+
+    return make_pair(dist, prev);
+}
+
+template <typename T, typename G>
+template <typename Allow>
+void graph_base<T, G>::dijkstra(dijkstra_workspace<T>& w, const int* first,
+                                const int* last, T bound, int target,
+                                Allow allow) const {
+    const G& g = self();
+    auto later = greater<pair<T,int>>();
+    w.reset(g.n);
+    for (; first != last; ++first) {
+        int s = *first;
+        w.seen[s] = w.gen, w.d[s] = 0, w.p[s] = -1;
+        w.q.emplace_back(0, s);
+    }
+
+    while (!w.q.empty()) {
+        pop_heap(w.q.begin(), w.q.end(), later);
+        T dx = w.q.back().first;
+        int x = w.q.back().second;
+        w.q.pop_back();
+        if (dx > bound)
+            break;
+        if (w.done[x] == w.gen)
+            continue;
+        w.done[x] = w.gen;
+        w.settled.push_back(x);
+        if (x == target)
+            break;
+        for (auto p : g.nbrs(x)) {
+            int c; T wt;
+            tie(c, wt) = p;
+            if (w.done[c] != w.gen && w.dist(c) > dx + wt && allow(x, c)) {
+                w.seen[c] = w.gen, w.d[c] = dx + wt, w.p[c] = x;
+                w.q.emplace_back(w.d[c], c);
+                push_heap(w.q.begin(), w.q.end(), later);
+            }
+        }
+    }
+}
+
+// Path i branches off path i-1 somewhere: for each spur node p[j], keep
+// the root p[0..j], forbid the root's other nodes and every arc out of
+// p[j] that an accepted path with the same root takes next, and search
+// from p[j] to t. Candidates wait in a set, cheapest first, deduplicated.
+// cost[j] := length of a path's prefix p[0..j]
+template <typename T, typename G>
+vector<pair<T, vector<int>>>
+graph_base<T, G>::k_shortest_paths(int s, int t, int k) const {
+    const G& g = self();
+    using path = pair<vector<T>, vector<int>>;
+    vector<pair<T, vector<int>>> res;
+    vector<path> found;
+    set<pair<T, path>> candidates;
+    dijkstra_workspace<T> w;
+    vector<int> skip;
+    // banned[x] == stamp iff x is on the current root; 64 bits, since
+    // there can be k * n spur searches.
+    vector<long long> banned(g.n, 0);
+    long long stamp = 0;
+
+    // Appends the search's path to t onto p, if it reached t.
+    auto extend = [&](path& p) {
+        if (!w.reached(t))
+            return false;
+        vector<int> spur;
+        for (int x = t; x != -1 && x != p.second.back(); x = w.prev(x))
+            spur.push_back(x);
+        T base = p.first.back();
+        for (int i = spur.size() - 1; i >= 0; --i)
+            p.second.push_back(spur[i]), p.first.push_back(base + w.dist(spur[i]));
+        return true;
+    };
+
+    path first({T(0)}, {s});
+    dijkstra(w, s, infty, t);
+    if (k > 0 && extend(first))
+        candidates.emplace(first.first.back(), first);
+
+    for (int i = 0; i < k && !candidates.empty(); ++i) {
+        path p = candidates.begin()->second;
+        candidates.erase(candidates.begin());
+        res.emplace_back(p.first.back(), p.second);
+        found.push_back(p);
+        for (int j = 0; j + 1 < (int) p.second.size(); ++j) {
+            int spur = p.second[j];
+            ++stamp;
+            for (int x = 0; x < j; ++x)
+                banned[p.second[x]] = stamp;
+            skip.clear();
+            for (auto& q : found)
+                if ((int) q.second.size() > j + 1 &&
+                    equal(q.second.begin(), q.second.begin() + j + 1, p.second.begin()))
+                    skip.push_back(q.second[j + 1]);
+            auto allow = [&](int x, int y) {
+                return banned[y] != stamp &&
+                       (x != spur || find(skip.begin(), skip.end(), y) == skip.end());
+            };
+            dijkstra(w, spur, infty, t, allow);
+            path next(vector<T>(p.first.begin(), p.first.begin() + j + 1),
+                      vector<int>(p.second.begin(), p.second.begin() + j + 1));
+            if (extend(next))
+                candidates.emplace(next.first.back(), next);
+        }
+    }
+    return res;
+}
+
+template <typename T, typename G>
+pair<T, vector<int>> graph_base<T, G>::shortest_path(int s, int t) const {
+    return a_star(s, t, [](int) { return T(0); });
+}
+
+template <typename T, typename G>
+template <typename H>
+pair<T, vector<int>> graph_base<T, G>::a_star(int s, int t, H h) const {
+    const G& g = self();
+    const int n = g.n;
     vector<T> dist(n, T(infty));
     vector<int> prev(n, -1);
     vector<bool> done(n);
     priority_queue<pair<T,int>,
                    vector<pair<T,int>>,
                    greater<pair<T,int>>> q;
-    q.emplace(0, s);
+    q.emplace(h(s), s);
     dist[s] = 0;
 
     while (!q.empty()) {
@@ -77,23 +847,101 @@ graph<T>::dijkstra(int s) const {
         if (done[x])
             continue;
         done[x] = true;
-        for (auto& p : adj[x]) {
+        if (x == t)
+            break;
+        for (auto p : g.nbrs(x)) {
             int c; T w;
             tie(c, w) = p;
             if (!done[c] && dist[c] > dist[x] + w) {
                 dist[c] = dist[x] + w;
                 prev[c] = x;
-                q.emplace(dist[c], c);
+                q.emplace(dist[c] + h(c), c);
             }
         }
     }
 
-    return make_pair(dist, prev);
+    vector<int> path;
+    if (!done[t])
+        return make_pair(T(infty), path);
+    for (int x = t; x != -1; x = prev[x])
+        path.push_back(x);
+    reverse(path.begin(), path.end());
+    return make_pair(dist[t], path);
 }
 
-template <typename T>
+// Side 0 searches forward from s over g, side 1 backward from t over
+// reverse. best := length of the shortest s-t path seen, through meet.
+// Once the heap minima sum to at least best, no shorter path remains.
+template <typename T, typename G>
+template <typename R>
+pair<T, vector<int>>
+graph_base<T, G>::shortest_path(int s, int t, const R& reverse) const {
+    const G& g = self();
+    const int n = g.n;
+    vector<T> dist[2] = {vector<T>(n, T(infty)), vector<T>(n, T(infty))};
+    vector<int> prev[2] = {vector<int>(n, -1), vector<int>(n, -1)};
+    vector<bool> done[2] = {vector<bool>(n), vector<bool>(n)};
+    priority_queue<pair<T,int>,
+                   vector<pair<T,int>>,
+                   greater<pair<T,int>>> q[2];
+    dist[0][s] = dist[1][t] = 0;
+    q[0].emplace(0, s);
+    q[1].emplace(0, t);
+    T best = s == t ? T(0) : T(infty);
+    int meet = s == t ? s : -1;
+
+    auto relax = [&](int side, int x, int c, T w) {
+        if (done[side][c] || dist[side][c] <= dist[side][x] + w)
+            return;
+        dist[side][c] = dist[side][x] + w;
+        prev[side][c] = x;
+        q[side].emplace(dist[side][c], c);
+        if (dist[!side][c] < infty && dist[side][c] + dist[!side][c] < best)
+            best = dist[side][c] + dist[!side][c], meet = c;
+    };
+
+    while (!q[0].empty() && !q[1].empty() &&
+           q[0].top().first + q[1].top().first < best) {
+        int side = q[0].size() > q[1].size();
+        int x = q[side].top().second;
+        q[side].pop();
+        if (done[side][x])
+            continue;
+        done[side][x] = true;
+        if (side == 0)
+            for (auto p : g.nbrs(x))
+                relax(0, x, p.first, p.second);
+        else
+            for (auto p : reverse.nbrs(x))
+                relax(1, x, p.first, p.second);
+    }
+
+    vector<int> path;
+    if (meet == -1)
+        return make_pair(T(infty), path);
+    for (int x = meet; x != -1; x = prev[0][x])
+        path.push_back(x);
+    std::reverse(path.begin(), path.end());
+    for (int x = prev[1][meet]; x != -1; x = prev[1][x])
+        path.push_back(x);
+    return make_pair(best, path);
+}
+
+template <typename T, typename G>
+csr_graph<T> graph_base<T, G>::reversed() const {
+    const G& g = self();
+    vector<tuple<int,int,T>> arcs;
+    for (int x = 0; x < g.n; ++x)
+        for (auto p : g.nbrs(x))
+            arcs.emplace_back(p.first, x, p.second);
+    return csr_graph<T>(g.n, arcs);
+}
+
+template <typename T, typename G>
 pair<vector<T>, vector<int>>
-graph<T>::bellman_ford(int s, bool* negative_cycle) const {
+graph_base<T, G>::bellman_ford(int s, bool* negative_cycle) const {
+    const G& g = self();
+    const int n = g.n;
     *negative_cycle = false;
     vector<T> dist(n, T(infty));
     vector<int> prev(n, -1);
@@ -101,7 +949,7 @@ graph<T>::bellman_ford(int s, bool* negative_cycle) const {
 
     for (int i = 0; i < n; ++i)
         for (int x = 0; x < n; ++x)
-            for (auto& p : adj[x])
+            for (auto p : g.nbrs(x))
                 if (dist[x] < infty)
                     if (dist[p.first] > dist[x] + p.second) {
                         dist[p.first] = dist[x] + p.second;
@@ -114,15 +962,82 @@ graph<T>::bellman_ford(int s, bool* negative_cycle) const {
     return make_pair(dist, prev);
 }
 
-template <typename T>
+// Every n relaxations, looks for a cycle in the parent pointers, which
+// exists only if there is a negative cycle, and is bound to appear if
+// there is one. Each check is O(V), so O(1) amortized per relaxation.
+template <typename T, typename G>
+pair<vector<T>, vector<int>>
+graph_base<T, G>::spfa(int s, vector<int>* negative_cycle) const {
+    const G& g = self();
+    const int n = g.n;
+    negative_cycle->clear();
+    vector<T> dist(n, T(infty));
+    vector<int> prev(n, -1), seen(n);
+    vector<bool> queued(n);
+    deque<int> q;
+    for (int x = 0; x < n; ++x)
+        if (s == -1 || x == s)
+            dist[x] = 0, queued[x] = true, q.push_back(x);
+
+    // Walks parent pointers from each node, marking nodes by walk. A walk
+    // that meets its own mark has closed a cycle.
+    auto find_cycle = [&] {
+        fill(seen.begin(), seen.end(), -1);
+        for (int v = 0; v < n; ++v) {
+            int x = v;
+            for (; x != -1 && seen[x] == -1; x = prev[x])
+                seen[x] = v;
+            if (x != -1 && seen[x] == v) {
+                int y = x;
+                do {
+                    negative_cycle->push_back(y);
+                    y = prev[y];
+                } while (y != x);
+                reverse(negative_cycle->begin(), negative_cycle->end());
+                return true;
+            }
+        }
+        return false;
+    };
+
+    long long relaxed = 0;
+    while (!q.empty()) {
+        int x = q.front();
+        q.pop_front();
+        queued[x] = false;
+        for (auto p : g.nbrs(x)) {
+            int c; T w;
+            tie(c, w) = p;
+            if (dist[c] <= dist[x] + w)
+                continue;
+            dist[c] = dist[x] + w;
+            prev[c] = x;
+            if (++relaxed % n == 0 && find_cycle())
+                return make_pair(dist, prev);
+            if (!queued[c]) {
+                queued[c] = true;
+                if (!q.empty() && dist[c] < dist[q.front()])
+                    q.push_front(c);
+                else
+                    q.push_back(c);
+            }
+        }
+    }
+
+    return make_pair(dist, prev);
+}
+
+template <typename T, typename G>
 pair<vector<vector<T>>, vector<vector<int>>>
-graph<T>::floyd_warshall() const {
+graph_base<T, G>::floyd_warshall() const {
+    const G& g = self();
+    const int n = g.n;
     vector<vector<T>> dist(n, vector<T>(n, T(infty)));
     vector<vector<int>> next(n, vector<int>(n, -1));
 
     for (int i = 0; i < n; ++i) {
         dist[i][i] = 0;
-        for (auto& p : adj[i]) {
+        for (auto p : g.nbrs(i)) {
             dist[i][p.first] = min(dist[i][p.first], p.second);
             next[i][p.first] = p.first;
         }
@@ -140,40 +1055,248 @@ graph<T>::floyd_warshall() const {
     return make_pair(dist, next);
 }
 
-template <typename T>
+// Tiled Floyd-Warshall (Venkataraman et al.). For each diagonal tile kb,
+// phase 1 relaxes tile (kb, kb) through itself, phase 2 the rest of row
+// and column kb through it, and phase 3 every other tile through its row
+// and column tiles. Tiles within phases 2 and 3 are independent.
+// Unreachable entries hold inf = infty / 2 during the run, so sums never
+// overflow and min needs no branch; anything above inf / 2 at the end is
+// unreachable. So |path lengths| must stay below inf / 2 = infty / 4; a
+// simple path takes at most one arc out of each node, so the sum over
+// nodes of their largest |out-arc weight| bounds it, and is asserted.
+template <typename T, typename G>
+pair<matrix<T>, matrix<int>>
+graph_base<T, G>::blocked_floyd_warshall(int threads) const {
+    const G& g = self();
+    const int n = g.n;
+    constexpr int b = 32;
+    const T inf = infty / 2;
+    T heaviest = 0;
+    for (int i = 0; i < n; ++i) {
+        T w = 0;
+        for (auto p : g.nbrs(i)) {
+            assert(p.second > -inf / 2 && p.second < inf / 2);
+            w = max(w, p.second < 0 ? -p.second : p.second);
+        }
+        assert(w < inf / 2 - heaviest);
+        heaviest += w;
+    }
+    matrix<T> dist(n, inf, b);
+    matrix<int> next(n, -1, b);
+    const int tiles = dist.size / b;
+    threads = max(1, threads);
+
+    for (int i = 0; i < n; ++i) {
+        dist[i][i] = 0;
+        for (auto p : g.nbrs(i)) {
+            dist[i][p.first] = min(dist[i][p.first], p.second);
+            next[i][p.first] = p.first;
+        }
+    }
+
+    // Relaxes tile (ci, cj) through pivots [kb, kb + b). The j loop
+    // vectorizes at -O2 into compares and selects only because it is
+    // marked ivdep: without it, GCC must assume a store through di or ni
+    // may change a later dk[j] and gives up. That is safe since iteration
+    // j touches only column j; when i == k, di and dk are the same row,
+    // but dk[j] is then read before di[j] is stored in the same iteration.
+    auto relax = [&](int ci, int cj, int kb) {
+        const int size = dist.size;
+        T* const d = dist[0];
+        int* const nx = next[0];
+        for (int k = kb; k < kb + b; ++k) {
+            const T* dk = d + size_t(k) * size + cj;
+            for (int i = ci; i < ci + b; ++i) {
+                const T a = d[size_t(i) * size + k];
+                const int hop = nx[size_t(i) * size + k];
+                T* di = d + size_t(i) * size + cj;
+                int* ni = nx + size_t(i) * size + cj;
+#pragma GCC ivdep
+                for (int j = 0; j < b; ++j) {
+                    const T via = a + dk[j];
+                    const T old = di[j];
+                    di[j] = via < old ? via : old;
+                    ni[j] = via < old ? hop : ni[j];
+                }
+            }
+        }
+    };
+    auto run = [&](int tasks, auto task) {
+        parallel_for(min(threads, tasks), [&](int t) {
+            for (int i = t; i < tasks; i += threads)
+                task(i);
+        });
+    };
+
+    for (int k = 0; k < tiles; ++k) {
+        int kb = k * b;
+        relax(kb, kb, kb);
+        run(2 * (tiles - 1), [&](int i) {
+            int t = i / 2 < k ? i / 2 : i / 2 + 1;
+            if (i % 2)
+                relax(kb, t * b, kb);
+            else
+                relax(t * b, kb, kb);
+        });
+        run((tiles - 1) * (tiles - 1), [&](int i) {
+            int r = i / (tiles - 1), c = i % (tiles - 1);
+            r += r >= k, c += c >= k;
+            relax(r * b, c * b, kb);
+        });
+    }
+
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j)
+            if (dist[i][j] > inf / 2)
+                dist[i][j] = infty, next[i][j] = -1;
+    return make_pair(move(dist), move(next));
+}
+
+template <typename T, typename G>
 pair<vector<vector<T>>, vector<vector<int>>>
-graph<T>::johnsons_algorithm(bool* negative_cycle) const {
-    *negative_cycle = false;
+graph_base<T, G>::johnsons_algorithm(bool* negative_cycle) const {
+    const int n = self().n;
+    auto flat = parallel_johnsons(negative_cycle);
     vector<vector<T>> dist(n);
     vector<vector<int>> prev(n);
-
-    graph<T> alt = *this;
-    alt.n += 1;
-    alt.adj.resize(alt.n);
-    for (int i = 0; i < n; ++i)
-        alt.arc(n, i, 0);
-    auto q_dist = alt.bellman_ford(n, negative_cycle).first;
     if (*negative_cycle)
         return make_pair(dist, prev);
+    for (int i = 0; i < n; ++i) {
+        dist[i].assign(flat.first[i], flat.first[i] + n);
+        prev[i].assign(flat.second[i], flat.second[i] + n);
+    }
+    return make_pair(dist, prev);
+}
 
-    alt.n -= 1;
-    alt.adj.resize(alt.n);
-    for (int i = 0; i < n; ++i)
-        for (auto& p : alt.adj[i])
-            p.second += q_dist[i] - q_dist[p.first];
+// Row s of the result holds dijkstra(s). Potentials h from SPFA make
+// every reweighted arc w + h[x] - h[c] non-negative. Threads claim
+// sources from a shared counter, so uneven searches still balance.
+template <typename T, typename G>
+pair<matrix<T>, matrix<int>>
+graph_base<T, G>::parallel_johnsons(bool* negative_cycle, int threads) const {
+    const G& g = self();
+    const int n = g.n;
+    vector<int> cycle;
+    auto h = g.spfa(-1, &cycle).first;
+    *negative_cycle = !cycle.empty();
+    if (*negative_cycle)
+        return make_pair(matrix<T>(0, infty), matrix<int>(0, -1));
 
-    for (int s = 0; s < n; ++s)
-        tie(dist[s], prev[s]) = alt.dijkstra(s);
-    for (int i = 0; i < n; ++i)
-        for (int j = 0; j < n; ++j)
-            if (dist[i][j] < infty)
-                dist[i][j] -= q_dist[i] - q_dist[j];
+    csr_graph<T> alt(*this);
+    for (int x = 0; x < n; ++x)
+        for (int i = alt.start[x]; i < alt.start[x+1]; ++i)
+            alt.w[i] += h[x] - h[alt.to[i]];
 
+    matrix<T> dist(n, infty);
+    matrix<int> prev(n, -1);
+    atomic<int> sources{0};
+    parallel_for(max(1, min(threads, n)), [&](int) {
+        vector<bool> done(n);
+        vector<pair<T,int>> q;
+        auto later = greater<pair<T,int>>();
+        for (int s; (s = sources++) < n; ) {
+            T* d = dist[s];
+            int* p = prev[s];
+            fill(done.begin(), done.end(), false);
+            d[s] = 0;
+            q.emplace_back(0, s);
+            while (!q.empty()) {
+                pop_heap(q.begin(), q.end(), later);
+                int x = q.back().second;
+                q.pop_back();
+                if (done[x])
+                    continue;
+                done[x] = true;
+                for (int i = alt.start[x]; i < alt.start[x+1]; ++i) {
+                    int c = alt.to[i];
+                    if (!done[c] && d[c] > d[x] + alt.w[i]) {
+                        d[c] = d[x] + alt.w[i];
+                        p[c] = x;
+                        q.emplace_back(d[c], c);
+                        push_heap(q.begin(), q.end(), later);
+                    }
+                }
+            }
+            for (int x = 0; x < n; ++x)
+                if (d[x] < infty)
+                    d[x] -= h[s] - h[x];
+        }
+    });
+
+    return make_pair(move(dist), move(prev));
+}
+
+// Kahn's algorithm. Level i holds the nodes whose longest incoming path
+// has i arcs, so each level is an antichain. Nodes on or after a cycle
+// are left out.
+template <typename T, typename G>
+vector<vector<int>> graph_base<T, G>::topological_levels() const {
+    const G& g = self();
+    const int n = g.n;
+    vector<int> indeg(n);
+    for (int x = 0; x < n; ++x)
+        for (auto p : g.nbrs(x))
+            ++indeg[p.first];
+    vector<vector<int>> levels(1);
+    for (int x = 0; x < n; ++x)
+        if (!indeg[x])
+            levels[0].push_back(x);
+    while (!levels.back().empty()) {
+        vector<int> level;
+        for (auto x : levels.back())
+            for (auto p : g.nbrs(x))
+                if (!--indeg[p.first])
+                    level.push_back(p.first);
+        levels.push_back(move(level));
+    }
+    levels.pop_back();
+    return levels;
+}
+
+// Calls f(x, c, w) for every arc, in topological order of x, so all arcs
+// into x are visited before any arc out of x. Nodes within a level are
+// independent. Returns false, visiting nothing, if the graph has a cycle.
+template <typename T, typename G>
+template <typename F>
+bool graph_base<T, G>::dag_dp(F f) const {
+    const G& g = self();
+    auto levels = topological_levels();
+    int count = 0;
+    for (auto& level : levels)
+        count += level.size();
+    if (count < g.n)
+        return false;
+    for (auto& level : levels)
+        for (auto x : level)
+            for (auto p : g.nbrs(x))
+                f(x, p.first, p.second);
+    return true;
+}
+
+// none := distance of unreachable nodes
+// better(a, b) := whether distance a should replace distance b
+template <typename T, typename G>
+template <typename Better>
+pair<vector<T>, vector<int>>
+graph_base<T, G>::dag_path(int s, T none, Better better) const {
+    const int n = self().n;
+    vector<T> dist(n, none);
+    vector<int> prev(n, -1);
+    dist[s] = 0;
+    bool acyclic = dag_dp([&](int x, int c, T w) {
+        if (dist[x] != none && (dist[c] == none || better(dist[x] + w, dist[c]))) {
+            dist[c] = dist[x] + w;
+            prev[c] = x;
+        }
+    });
+    assert(acyclic);
     return make_pair(dist, prev);
 }
 
-template <typename T>
-T graph<T>::mst() const {
+template <typename T, typename G>
+T graph_base<T, G>::mst() const {
+    const G& g = self();
+    const int n = g.n;
     vector<bool> done(n);
     priority_queue<pair<T,int>,
                    vector<pair<T,int>>,
@@ -188,7 +1311,7 @@ T graph<T>::mst() const {
         if (!done[c]) {
             done[c] = true;
             ret += w;
-            for (auto& p : adj[c]) {
+            for (auto p : g.nbrs(c)) {
                 q.emplace(p.second, p.first);
             }
         }
@@ -197,6 +1320,439 @@ T graph<T>::mst() const {
     return ret;
 }
 
+// Sorts arc indices by weight, radix sorting integer weights 8 bits at a
+// time on their offset from the minimum, skipping digits all keys share.
+template <typename T, typename G>
+vector<tuple<int,int,T>> graph_base<T, G>::kruskal() const {
+    const G& g = self();
+    const int n = g.n;
+    vector<tuple<int,int,T>> arcs, tree;
+    for (int x = 0; x < n; ++x)
+        for (auto p : g.nbrs(x))
+            arcs.emplace_back(x, p.first, p.second);
+    const int m = arcs.size();
+    vector<int> order(m), tmp(m);
+    for (int i = 0; i < m; ++i)
+        order[i] = i;
+
+    if constexpr (is_integral<T>::value) {
+        using U = typename make_unsigned<T>::type;
+        vector<U> key(m);
+        U any = 0, all = ~U(0);
+        if (m) {
+            T least = get<2>(*min_element(arcs.begin(), arcs.end(),
+                [](auto& a, auto& b) { return get<2>(a) < get<2>(b); }));
+            for (int i = 0; i < m; ++i) {
+                key[i] = U(get<2>(arcs[i])) - U(least);
+                any |= key[i], all &= key[i];
+            }
+        }
+        for (int shift = 0; shift < 8 * (int) sizeof(U); shift += 8) {
+            if (((any ^ all) >> shift & 0xff) == 0)
+                continue;
+            int count[257] = {};
+            for (auto i : order)
+                ++count[(key[i] >> shift & 0xff) + 1];
+            for (int d = 0; d < 256; ++d)
+                count[d+1] += count[d];
+            for (auto i : order)
+                tmp[count[key[i] >> shift & 0xff]++] = i;
+            swap(order, tmp);
+        }
+    } else {
+        stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return get<2>(arcs[a]) < get<2>(arcs[b]);
+        });
+    }
+
+    union_find u(n);
+    for (auto i : order) {
+        int x = get<0>(arcs[i]), y = get<1>(arcs[i]);
+        if (u.rep(x) != u.rep(y)) {
+            u.merge(x, y);
+            tree.push_back(arcs[i]);
+        }
+    }
+    return tree;
+}
+
+// comp[x] := current component of node x, the union_find representative
+// best[c] := lightest arc leaving component c this round, or -1; each
+//            thread keeps its own, combined after the scan
+template <typename T, typename G>
+vector<tuple<int,int,T>> graph_base<T, G>::boruvka(int threads) const {
+    const G& g = self();
+    const int n = g.n;
+    threads = max(1, threads);
+    vector<tuple<int,int,T>> arcs, tree;
+    for (int x = 0; x < n; ++x)
+        for (auto p : g.nbrs(x))
+            if (p.first != x)
+                arcs.emplace_back(x, p.first, p.second);
+    const int m = arcs.size();
+    vector<int> comp(n);
+    for (int x = 0; x < n; ++x)
+        comp[x] = x;
+    vector<vector<int>> local(threads, vector<int>(n, -1));
+    vector<int> best(n, -1);
+    union_find u(n);
+    auto lighter = [&](int a, int b) {
+        return b == -1 || get<2>(arcs[a]) < get<2>(arcs[b]) ||
+               (get<2>(arcs[a]) == get<2>(arcs[b]) && a < b);
+    };
+    auto chunk = [&](int t, int size) {
+        return make_pair(size_t(size) * t / threads, size_t(size) * (t + 1) / threads);
+    };
+
+    for (bool merged = true; merged; ) {
+        parallel_for(threads, [&](int t) {
+            auto& mine = local[t];
+            auto r = chunk(t, m);
+            for (size_t i = r.first; i < r.second; ++i) {
+                int cx = comp[get<0>(arcs[i])], cy = comp[get<1>(arcs[i])];
+                if (cx == cy)
+                    continue;
+                if (lighter(i, mine[cx])) mine[cx] = i;
+                if (lighter(i, mine[cy])) mine[cy] = i;
+            }
+        });
+        parallel_for(threads, [&](int t) {
+            auto r = chunk(t, n);
+            for (size_t c = r.first; c < r.second; ++c) {
+                best[c] = -1;
+                for (auto& mine : local)
+                    if (mine[c] != -1 && lighter(mine[c], best[c]))
+                        best[c] = mine[c];
+                for (auto& mine : local)
+                    mine[c] = -1;
+            }
+        });
+
+        merged = false;
+        for (int c = 0; c < n; ++c) {
+            if (best[c] == -1)
+                continue;
+            int x = get<0>(arcs[best[c]]), y = get<1>(arcs[best[c]]);
+            if (u.rep(x) != u.rep(y)) {
+                u.merge(x, y);
+                tree.push_back(arcs[best[c]]);
+                merged = true;
+            }
+        }
+        for (int x = 0; x < n; ++x)
+            comp[x] = u.rep(x);
+    }
+    return tree;
+}
+
+// Returns the old ids in their new order; see unweighted.cpp.
+template <typename T, typename G>
+vector<int> graph_base<T, G>::vertex_order(ordering o) const {
+    const G& g = self();
+    const int n = g.n;
+    vector<int> deg(n), by(n), order;
+    for (int x = 0; x < n; ++x)
+        deg[x] = g.nbrs(x).size(), by[x] = x;
+    auto lower = [&](int a, int b) { return deg[a] < deg[b]; };
+    if (o == ordering::degree) {
+        stable_sort(by.begin(), by.end(), [&](int a, int b) { return deg[a] > deg[b]; });
+        return by;
+    }
+    if (o == ordering::rcm)
+        stable_sort(by.begin(), by.end(), lower);
+    vector<bool> seen(n);
+    order.reserve(n);
+    for (auto s : by) {
+        if (seen[s])
+            continue;
+        seen[s] = true;
+        order.push_back(s);
+        for (size_t i = order.size() - 1; i < order.size(); ++i) {
+            size_t first = order.size();
+            for (auto p : g.nbrs(order[i]))
+                if (!seen[p.first])
+                    seen[p.first] = true, order.push_back(p.first);
+            if (o == ordering::rcm)
+                stable_sort(order.begin() + first, order.end(), lower);
+        }
+    }
+    if (o == ordering::rcm)
+        reverse(order.begin(), order.end());
+    return order;
+}
+
+template <typename T, typename G>
+relabeled<graph<T>>
+graph_base<T, G>::relabel(const vector<int>& backward) const {
+    const G& g = self();
+    const int n = g.n;
+    relabeled<graph<T>> r{graph<T>(n), vector<int>(n), backward};
+    for (int y = 0; y < n; ++y)
+        r.forward[backward[y]] = y;
+    for (int y = 0; y < n; ++y) {
+        auto& adj = r.g.adj[y];
+        adj.reserve(g.nbrs(backward[y]).size());
+        for (auto p : g.nbrs(backward[y]))
+            adj.emplace_back(r.forward[p.first], p.second);
+        sort(adj.begin(), adj.end());
+    }
+    return r;
+}
+
+template <typename T, typename G>
+relabeled<graph<T>> graph_base<T, G>::relabel(ordering o) const {
+    return relabel(vertex_order(o));
+}
+
+#ifdef BENCHMARK
+#include <chrono>
+
+chrono::steady_clock::time_point now() { return chrono::steady_clock::now(); }
+
+// Seconds elapsed since t.
+double secs(chrono::steady_clock::time_point t) {
+    return chrono::duration<double>(now() - t).count();
+}
+
+// Xorshift generator, so benchmark inputs are the same on every platform.
+struct xorshift {
+    unsigned long long seed = 88172645463325252ull;
+    unsigned long long operator()() {
+        seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+        return seed;
+    }
+};
+
+// Dijkstra on a side x side grid with shuffled ids, before and after
+// relabeling. Compile with -DBENCHMARK.
+void benchmark_locality(int side) {
+    int n = side * side;
+    xorshift next;
+    vector<int> id(n);
+    for (int i = 0; i < n; ++i)
+        id[i] = i;
+    for (int i = 1; i < n; ++i)
+        swap(id[i], id[next() % (i + 1)]);
+    graph<int> g(n);
+    for (int i = 0; i < n; ++i) {
+        if (i % side + 1 < side) g.edge(id[i], id[i + 1], 1 + next() % 100);
+        if (i + side < n) g.edge(id[i], id[i + side], 1 + next() % 100);
+    }
+
+    auto t = now();
+    auto dist = g.dijkstra(id[0]).first;
+    cout << "grid, n = " << n << endl;
+    cout << "  input : dijkstra " << secs(t) << " s" << endl;
+    for (auto o : {ordering::bfs, ordering::rcm, ordering::degree}) {
+        auto r = g.relabel(o);
+        t = now();
+        auto d = r.g.dijkstra(r.forward[id[0]]).first;
+        cout << "  " << (o == ordering::bfs ? "bfs   " : o == ordering::rcm ? "rcm   " : "degree")
+             << ": dijkstra " << secs(t) << " s" << endl;
+        assert(d[r.forward[id[n - 1]]] == dist[id[n - 1]]);
+    }
+}
+
+// Dijkstra with each priority queue on a side x side grid with weights in
+// [1, 100], and on a road-like graph: a grid with a third of its streets
+// removed plus fast highways every 50 rows and columns.
+void benchmark_queues(int side) {
+    int n = side * side;
+    xorshift next;
+    graph<int> grid(n), road(n);
+    for (int i = 0; i < n; ++i) {
+        int r = i / side, c = i % side;
+        if (c + 1 < side) {
+            grid.edge(i, i + 1, 1 + next() % 100);
+            if (r % 50 == 0)
+                road.edge(i, i + 1, 10);
+            else if (next() % 3)
+                road.edge(i, i + 1, 20 + next() % 80);
+        }
+        if (r + 1 < side) {
+            grid.edge(i, i + side, 1 + next() % 100);
+            if (c % 50 == 0)
+                road.edge(i, i + side, 10);
+            else if (next() % 3)
+                road.edge(i, i + side, 20 + next() % 80);
+        }
+    }
+
+    for (auto* g : {&grid, &road}) {
+        cout << (g == &grid ? "grid" : "road") << ", n = " << n << endl;
+        auto run = [&](const char* name, auto f) {
+            auto t = now();
+            auto dist = f();
+            cout << "  " << name << ": dijkstra " << secs(t) << " s" << endl;
+            return dist;
+        };
+        auto dist = run("binary_heap ", [&] { return g->dijkstra(0).first; });
+        assert(run("quad_heap   ", [&] { return g->dijkstra<quad_heap<int>>(0).first; }) == dist);
+        assert(run("radix_heap  ", [&] { return g->dijkstra<radix_heap<int>>(0).first; }) == dist);
+        assert(run("bucket_queue", [&] { return g->dijkstra<bucket_queue<int>>(0).first; }) == dist);
+    }
+}
+
+// Blocked Floyd-Warshall against the plain triple loop on nested
+// vectors, on a random graph with n nodes and 8n arcs. The inner loop
+// vectorizes at -O2 with SSE2; -march=native widens the vectors.
+void benchmark_floyd_warshall(int n) {
+    graph<int> g(n);
+    for (int k = 0; k < 8 * n; ++k)
+        g.arc(rand() % n, rand() % n, rand() % 1000);
+
+    auto t = now();
+    auto dist = g.floyd_warshall().first;
+    double plain = secs(t);
+
+    cout << "floyd-warshall, n = " << n << endl;
+    cout << "  nested vectors: " << plain << " s" << endl;
+    for (int threads = 1; threads <= (int) thread::hardware_concurrency(); threads *= 2) {
+        t = now();
+        auto fw = g.blocked_floyd_warshall(threads);
+        cout << "  blocked, " << threads << " threads: " << secs(t) << " s" << endl;
+        for (int i = 0; i < n; ++i)
+            assert(equal(dist[i].begin(), dist[i].end(), fw.first[i]));
+    }
+}
+
+// Parallel Johnson's against n serial dijkstra calls into nested vectors,
+// on a random graph with n nodes and 8n arcs. Weights w + q[x] - q[y] for
+// random q make some arcs negative without making negative cycles.
+void benchmark_johnsons(int n) {
+    graph<int> g(n);
+    vector<int> q(n);
+    for (auto& x : q)
+        x = rand() % 100;
+    for (int k = 0; k < 8 * n; ++k) {
+        int x = rand() % n, y = rand() % n;
+        g.arc(x, y, rand() % 1000 + q[x] - q[y]);
+    }
+
+    auto t = now();
+    vector<int> cycle;
+    auto h = g.spfa(-1, &cycle).first;
+    assert(cycle.empty());
+    graph<int> alt(n);
+    for (int x = 0; x < n; ++x)
+        for (auto p : g.adj[x])
+            alt.arc(x, p.first, p.second + h[x] - h[p.first]);
+    vector<vector<int>> dist(n), prev(n);
+    for (int s = 0; s < n; ++s)
+        tie(dist[s], prev[s]) = alt.dijkstra(s);
+    double serial = secs(t);
+
+    cout << "johnson's, n = " << n << ", m = " << 8 * n << endl;
+    cout << "  serial dijkstra: " << serial << " s" << endl;
+    for (int threads = 1; threads <= (int) thread::hardware_concurrency(); threads *= 2) {
+        bool neg_cycle;
+        t = now();
+        auto ja = g.parallel_johnsons(&neg_cycle, threads);
+        cout << "  parallel, " << threads << " threads: " << secs(t) << " s" << endl;
+        assert(!neg_cycle);
+        for (int x = 0; x < n; ++x)
+            assert(ja.first[0][x] == (dist[0][x] < g.infty ? dist[0][x] - h[0] + h[x] : g.infty));
+    }
+}
+
+// Prim, Kruskal and Boruvka on a random connected graph with n nodes and
+// m undirected edges with weights below 1e6.
+void benchmark_mst(int n, int m) {
+    xorshift next;
+    graph<long long> g(n);
+    for (int i = 1; i < n; ++i)
+        g.edge(next() % i, i, next() % 1000000);
+    for (int i = n - 1; i < m; ++i)
+        g.edge(next() % n, next() % n, next() % 1000000);
+    auto total = [](const vector<tuple<int,int,long long>>& tree) {
+        long long sum = 0;
+        for (auto& e : tree)
+            sum += get<2>(e);
+        return sum;
+    };
+
+    cout << "mst, n = " << n << ", m = " << m << endl;
+    auto t = now();
+    long long prim = g.mst();
+    cout << "  prim:    " << secs(t) << " s" << endl;
+    t = now();
+    assert(total(g.kruskal()) == prim);
+    cout << "  kruskal: " << secs(t) << " s" << endl;
+    for (int threads = 1; threads <= (int) thread::hardware_concurrency(); threads *= 2) {
+        t = now();
+        assert(total(g.boruvka(threads)) == prim);
+        cout << "  boruvka, " << threads << " threads: " << secs(t) << " s" << endl;
+    }
+}
+
+// Random s-t queries on the road-like grid of benchmark_queues: a full
+// dijkstra, early exit, bidirectional, and A* with 10 x the Manhattan
+// distance, which is consistent since every arc weighs at least 10.
+void benchmark_point_to_point(int side, int queries) {
+    int n = side * side;
+    xorshift next;
+    graph<int> road(n);
+    for (int i = 0; i < n; ++i) {
+        int r = i / side, c = i % side;
+        if (c + 1 < side && (r % 50 == 0 || next() % 3))
+            road.edge(i, i + 1, r % 50 == 0 ? 10 : 20 + next() % 80);
+        if (r + 1 < side && (c % 50 == 0 || next() % 3))
+            road.edge(i, i + side, c % 50 == 0 ? 10 : 20 + next() % 80);
+    }
+    vector<pair<int,int>> st(queries);
+    for (auto& q : st)
+        q = make_pair(next() % n, next() % n);
+
+    cout << "point-to-point, n = " << n << ", " << queries << " queries" << endl;
+    vector<int> expected;
+    auto t = now();
+    for (auto& q : st)
+        expected.push_back(road.dijkstra(q.first).first[q.second]);
+    cout << "  dijkstra:      " << secs(t) / queries * 1e3 << " ms/query" << endl;
+    auto run = [&](const char* name, auto f) {
+        auto t = now();
+        for (int i = 0; i < queries; ++i)
+            assert(f(st[i].first, st[i].second).first == expected[i]);
+        cout << "  " << name << secs(t) / queries * 1e3 << " ms/query" << endl;
+    };
+    run("early exit:    ", [&](int s, int e) { return road.shortest_path(s, e); });
+    run("bidirectional: ", [&](int s, int e) { return road.shortest_path(s, e, road); });
+    run("a*:            ", [&](int s, int e) {
+        return road.a_star(s, e, [&](int x) {
+            return 10 * (abs(x % side - e % side) + abs(x / side - e / side));
+        });
+    });
+}
+
+// Local queries, within distance 500 (about two thousand nodes), on a
+// side x side grid: fresh dijkstra calls, which cannot stop early and
+// set up O(n) arrays, against a reused workspace with a bound.
+void benchmark_workspace(int side, int queries) {
+    int n = side * side;
+    graph<int> grid(n);
+    for (int i = 0; i < n; ++i) {
+        if (i % side + 1 < side) grid.edge(i, i + 1, 10 + rand() % 20);
+        if (i + side < n) grid.edge(i, i + side, 10 + rand() % 20);
+    }
+
+    cout << "local queries, n = " << n << endl;
+    int fresh = max(1, queries / 10000);
+    auto t = now();
+    for (int k = 0; k < fresh; ++k)
+        grid.dijkstra(rand() % n);
+    cout << "  fresh dijkstra:     " << secs(t) / fresh * 1e6 << " us/query" << endl;
+    dijkstra_workspace<int> w;
+    long long settled = 0;
+    t = now();
+    for (int k = 0; k < queries; ++k) {
+        grid.dijkstra(w, rand() % n, 500);
+        settled += w.settled.size();
+    }
+    cout << "  workspace, bounded: " << secs(t) / queries * 1e6 << " us/query, "
+         << settled / queries << " nodes settled" << endl;
+}
+#endif
+
 int main() {
     graph<int> g(4);
     g.arc(0, 1, 2);
@@ -216,6 +1772,9 @@ int main() {
     g.johnsons_algorithm(&neg_cycle);
     assert(neg_cycle);
     assert(g.mst() == -4);
+    vector<int> cycle;
+    g.spfa(0, &cycle);
+    assert(cycle.size() == 2 || cycle.size() == 3);
 
     int n = 30;
     g = graph<int>(n);
@@ -247,6 +1806,442 @@ int main() {
         }
     }
 
+    // Floyd-Warshall keeps the full weight range, unlike the blocked one.
+    {
+        graph<int> g(3);
+        g.arc(0, 1, 600000000);
+        g.arc(1, 2, 600000000);
+        auto fw = g.floyd_warshall();
+        assert(fw.first[0] == vector<int>({0, 600000000, 1200000000}));
+        assert(fw.second[0] == vector<int>({-1, 1, 1}));
+        assert(fw.first[2][0] == g.infty);
+        graph<long long> h(2);
+        h.arc(0, 1, 3000000000000000000ll);
+        assert(h.floyd_warshall().first[0][1] == 3000000000000000000ll);
+    }
+
+    // Blocked Floyd-Warshall across several tiles and threads, against
+    // Bellman-Ford, with paths rebuilt from next.
+    for (int t = 0; t < 20; ++t) {
+        int n = 1 + rand() % 100;
+        graph<int> g(n);
+        for (int k = rand() % (5 * n); k > 0; --k)
+            g.arc(rand() % n, rand() % n, rand() % 100 - (t % 2 ? 5 : 0));
+        vector<int> cycle;
+        g.spfa(-1, &cycle);
+        if (!cycle.empty())
+            continue;
+        auto fw = g.blocked_floyd_warshall(1 + t % 4);
+        for (int s = 0; s < n; ++s) {
+            auto bf = g.bellman_ford(s, &neg_cycle).first;
+            for (int x = 0; x < n; ++x) {
+                assert(fw.first[s][x] == bf[x]);
+                if (x == s || bf[x] == g.infty) {
+                    assert(x == s || fw.second[s][x] == -1);
+                    continue;
+                }
+                int len = 0, hops = 0;
+                for (int y = s; y != x; y = fw.second[y][x], ++hops) {
+                    int z = fw.second[y][x], best = g.infty;
+                    for (auto& a : g.adj[y])
+                        if (a.first == z)
+                            best = min(best, a.second);
+                    assert(best < g.infty && hops < n);
+                    len += best;
+                }
+                assert(len == bf[x]);
+            }
+        }
+    }
+
+    // Parallel Johnson's against Floyd-Warshall, with valid parents.
+    for (int t = 0; t < 50; ++t) {
+        int n = 1 + rand() % 60;
+        graph<int> g(n);
+        for (int k = rand() % (4 * n); k > 0; --k)
+            g.arc(rand() % n, rand() % n, rand() % 100 - 5);
+        auto ja = g.parallel_johnsons(&neg_cycle, 1 + t % 4);
+        auto fw = g.floyd_warshall().first;
+        vector<int> cycle;
+        g.spfa(-1, &cycle);
+        assert(neg_cycle == !cycle.empty());
+        if (neg_cycle)
+            continue;
+        csr_graph<int> c(g);
+        for (int s = 0; s < n; ++s)
+            for (int x = 0; x < n; ++x) {
+                assert(ja.first[s][x] == fw[s][x]);
+                assert(c.nbrs(x).size() == (int) g.adj[x].size());
+                int p = ja.second[s][x];
+                if (p == -1) {
+                    assert(x == s || fw[s][x] == g.infty);
+                    continue;
+                }
+                bool found = false;
+                for (auto a : c.nbrs(p))
+                    found |= a.first == x && fw[s][p] + a.second == fw[s][x];
+                assert(found);
+            }
+    }
+
+    // Workspace queries against fresh dijkstra calls: one workspace across
+    // graphs of different sizes, several sources, and distance bounds.
+    {
+        dijkstra_workspace<int> w;
+        for (int t = 0; t < 200; ++t) {
+            int n = 1 + rand() % 40;
+            graph<int> g(n);
+            for (int k = rand() % (4 * n); k > 0; --k)
+                g.arc(rand() % n, rand() % n, rand() % 20);
+            vector<int> sources;
+            for (int k = 1 + rand() % 3; k > 0; --k)
+                sources.push_back(rand() % n);
+            vector<int> expected(n, g.infty);
+            for (auto s : sources) {
+                auto dist = g.dijkstra(s).first;
+                for (int x = 0; x < n; ++x)
+                    expected[x] = min(expected[x], dist[x]);
+            }
+            int bound = t % 2 ? g.infty : rand() % 40;
+            auto within = [&](int d) { return d < g.infty && d <= bound; };
+            g.dijkstra(w, sources, bound);
+            for (int x = 0; x < n; ++x) {
+                assert(w.reached(x) == within(expected[x]));
+                if (w.reached(x))
+                    assert(w.dist(x) == expected[x]);
+                int p = w.prev(x);
+                if (w.reached(x) && p != -1) {
+                    bool found = false;
+                    for (auto& a : g.adj[p])
+                        found |= a.first == x && expected[p] + a.second == expected[x];
+                    assert(found);
+                }
+            }
+            assert((int) w.settled.size() == count_if(expected.begin(), expected.end(), within));
+        }
+        w.gen = numeric_limits<int>::max() - 1;
+        graph<int> g(2);
+        g.arc(0, 1, 5);
+        g.dijkstra(w, 0);
+        assert(w.gen == 1 && w.dist(1) == 5 && w.reached(1));
+    }
+
+    // K shortest loopless paths against every simple path, by DFS.
+    for (int t = 0; t < 200; ++t) {
+        int n = 1 + rand() % 8, k = 1 + rand() % 20;
+        graph<int> g(n);
+        vector<vector<int>> cost(n, vector<int>(n, g.infty));
+        for (int e = rand() % (3 * n); e > 0; --e) {
+            int a = rand() % n, b = rand() % n, c = rand() % 10;
+            g.arc(a, b, c);
+            cost[a][b] = min(cost[a][b], c);
+        }
+        int s = rand() % n, e = rand() % n;
+        vector<int> all, path = {s};
+        vector<bool> on(n);
+        on[s] = true;
+        function<void(int)> walk = [&](int d) {
+            int x = path.back();
+            if (x == e) {
+                all.push_back(d);
+                return;
+            }
+            for (int y = 0; y < n; ++y)
+                if (!on[y] && cost[x][y] < g.infty) {
+                    on[y] = true, path.push_back(y);
+                    walk(d + cost[x][y]);
+                    on[y] = false, path.pop_back();
+                }
+        };
+        walk(0);
+        sort(all.begin(), all.end());
+        all.resize(min<int>(all.size(), k));
+
+        auto res = g.k_shortest_paths(s, e, k);
+        assert(res.size() == all.size());
+        set<vector<int>> distinct;
+        for (int i = 0; i < (int) res.size(); ++i) {
+            auto& p = res[i].second;
+            assert(res[i].first == all[i]);
+            assert(p.front() == s && p.back() == e);
+            assert(set<int>(p.begin(), p.end()).size() == p.size());
+            int d = 0;
+            for (int j = 0; j + 1 < (int) p.size(); ++j)
+                d += cost[p[j]][p[j + 1]];
+            assert(d == res[i].first);
+            distinct.insert(p);
+        }
+        assert(distinct.size() == res.size());
+    }
+
+    // Point-to-point queries against dijkstra, with valid paths.
+    for (int t = 0; t < 200; ++t) {
+        int n = 1 + rand() % 40;
+        graph<int> g(n);
+        for (int k = rand() % (4 * n); k > 0; --k)
+            g.arc(rand() % n, rand() % n, rand() % 20);
+        auto rev = g.reversed();
+        int s = rand() % n, e = rand() % n;
+        auto dist = g.dijkstra(s).first;
+        auto check = [&](const pair<int, vector<int>>& res) {
+            assert(res.first == dist[e]);
+            if (dist[e] == g.infty) {
+                assert(res.second.empty());
+                return;
+            }
+            assert(res.second.front() == s && res.second.back() == e);
+            int len = 0;
+            for (size_t i = 0; i + 1 < res.second.size(); ++i) {
+                int best = g.infty;
+                for (auto& a : g.adj[res.second[i]])
+                    if (a.first == res.second[i + 1])
+                        best = min(best, a.second);
+                assert(best < g.infty);
+                len += best;
+            }
+            assert(len == dist[e]);
+        };
+        check(g.shortest_path(s, e));
+        check(g.shortest_path(s, e, rev));
+        check(g.a_star(s, e, [](int) { return 0; }));
+    }
+
+    // A* with the Manhattan distance on a grid with weights >= 1.
+    {
+        int w = 30, n = w * w;
+        graph<int> grid(n);
+        for (int i = 0; i < n; ++i) {
+            if (i % w + 1 < w) grid.edge(i, i + 1, 1 + rand() % 9);
+            if (i + w < n) grid.edge(i, i + w, 1 + rand() % 9);
+        }
+        for (int k = 0; k < 20; ++k) {
+            int s = rand() % n, e = rand() % n;
+            auto h = [&](int x) { return abs(x % w - e % w) + abs(x / w - e / w); };
+            auto res = grid.a_star(s, e, h);
+            assert(res.first == grid.dijkstra(s).first[e]);
+            assert(grid.shortest_path(s, e, grid).first == res.first);
+        }
+    }
+
+    // Kruskal and Boruvka find spanning forests of the same weight as a
+    // brute force over edge subsets, and as Prim when connected.
+    for (int t = 0; t < 200; ++t) {
+        int n = 1 + rand() % 7, m = rand() % 9;
+        graph<int> g(n);
+        graph<double> h(n);
+        vector<tuple<int,int,int>> edges;
+        for (int i = 0; i < m; ++i) {
+            int x = rand() % n, y = rand() % n, w = rand() % 20 - 5;
+            g.edge(x, y, w);
+            h.edge(x, y, w / 4.0);
+            edges.emplace_back(x, y, w);
+        }
+        union_find all(n);
+        for (auto& e : edges)
+            all.merge(get<0>(e), get<1>(e));
+        int components = all.c, best = g.infty;
+        for (int mask = 0; mask < 1 << m; ++mask) {
+            union_find u(n);
+            int total = 0;
+            bool forest = true;
+            for (int i = 0; i < m; ++i)
+                if (mask >> i & 1) {
+                    int x = get<0>(edges[i]), y = get<1>(edges[i]);
+                    forest &= u.rep(x) != u.rep(y);
+                    u.merge(x, y);
+                    total += get<2>(edges[i]);
+                }
+            if (forest && u.c == components)
+                best = min(best, total);
+        }
+        auto weight = [&](const auto& tree) {
+            union_find u(n);
+            double total = 0;
+            for (auto& e : tree) {
+                assert(u.rep(get<0>(e)) != u.rep(get<1>(e)));
+                u.merge(get<0>(e), get<1>(e));
+                total += get<2>(e);
+            }
+            assert(u.c == components);
+            return total;
+        };
+        assert(weight(g.kruskal()) == best);
+        assert(weight(g.boruvka(1 + t % 3)) == best);
+        assert(weight(h.kruskal()) == best / 4.0);
+        assert(weight(h.boruvka(2)) == best / 4.0);
+        if (components == 1)
+            assert(g.mst() == best);
+    }
+
+    // SPFA against Bellman-Ford; any cycle it returns is negative.
+    for (int t = 0; t < 300; ++t) {
+        int n = 1 + rand() % 30;
+        graph<int> g(n);
+        for (int k = rand() % (3 * n); k > 0; --k)
+            g.arc(rand() % n, rand() % n, rand() % 100 - (t % 3 ? 10 : 0));
+        int s = t % 5 ? rand() % n : -1;
+        vector<int> cycle;
+        auto res = g.spfa(s, &cycle);
+        if (s == -1) {
+            graph<int> h(n + 1);
+            h.adj = g.adj;
+            h.adj.emplace_back();
+            for (int x = 0; x < n; ++x)
+                h.arc(n, x, 0);
+            h.bellman_ford(n, &neg_cycle);
+        } else {
+            auto bf = g.bellman_ford(s, &neg_cycle).first;
+            if (!neg_cycle)
+                assert(res.first == bf);
+        }
+        assert(neg_cycle == !cycle.empty());
+        int total = 0;
+        for (size_t i = 0; i < cycle.size(); ++i) {
+            int x = cycle[i], y = cycle[(i + 1) % cycle.size()], best = g.infty;
+            for (auto& a : g.adj[x])
+                if (a.first == y)
+                    best = min(best, a.second);
+            assert(best < g.infty);
+            total += best;
+        }
+        assert(cycle.empty() || total < 0);
+    }
+
+    // DAG shortest and longest paths against Bellman-Ford.
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 30;
+        vector<int> perm(n);
+        for (int i = 0; i < n; ++i) {
+            perm[i] = i;
+            swap(perm[i], perm[rand() % (i + 1)]);
+        }
+        graph<int> dag(n), neg(n);
+        for (int i = rand() % 100; i > 0; --i) {
+            int a = rand() % n, b = rand() % n, w = rand() % 200 - 100;
+            if (a == b)
+                continue;
+            if (a > b)
+                swap(a, b);
+            dag.arc(perm[a], perm[b], w);
+            neg.arc(perm[a], perm[b], -w);
+        }
+        int s = rand() % n;
+        auto bf = dag.bellman_ford(s, &neg_cycle);
+        assert(!neg_cycle);
+        assert(dag.dag_shortest_path(s).first == bf.first);
+        auto longest = dag.dag_longest_path(s).first;
+        auto negated = neg.bellman_ford(s, &neg_cycle).first;
+        for (int i = 0; i < n; ++i)
+            assert(negated[i] == g.infty ? longest[i] == -g.infty
+                                         : longest[i] == -negated[i]);
+    }
+    g = graph<int>(3);
+    g.arc(0, 1, 1);
+    g.arc(1, 2, 1);
+    assert(g.topological_levels() == vector<vector<int>>({{0}, {1}, {2}}));
+    g.arc(2, 1, 1);
+    assert(!g.dag_dp([](int, int, int) {}));
+
+    // Binary graph files round-trip through mmap.
+    {
+        const char* path = "shortest_path.test.graph";
+        istringstream text("4 5\n0 1 2\n1 2 1\n0 3 1\n3 2 3\n2 0 -2\n");
+        g = read_edge_list<int>(text);
+        assert(write_graph(path, g));
+        mapped_graph<int> m(path);
+        assert(m && m.n == 4);
+        for (int i = 0; i < 4; ++i) {
+            assert(m.nbrs(i).size() == (int) g.adj[i].size());
+            for (int k = 0; k < m.nbrs(i).size(); ++k)
+                assert(m.nbrs(i)[k] == g.adj[i][k]);
+        }
+        assert(m.bellman_ford(0, &neg_cycle).first == vector<int>({0, 2, 3, 1}));
+        assert(!neg_cycle);
+        assert(m.johnsons_algorithm(&neg_cycle).first == g.floyd_warshall().first);
+        assert(!mapped_graph<long long>(path));
+        // Truncated, or with an arc count that overflows the size check.
+        assert(truncate(path, sizeof(graph_file_header) + 8 * sizeof(int)) == 0);
+        assert(!mapped_graph<int>(path));
+        assert(write_graph(path, g));
+        {
+            fstream f(path, ios::in | ios::out | ios::binary);
+            int64_t m = (int64_t(1) << 62) - 5;
+            f.seekp(offsetof(graph_file_header, m));
+            f.write((const char*) &m, sizeof m);
+        }
+        assert(!mapped_graph<int>(path));
+        // A corrupt body passes the header checks unless check is set.
+        auto poke = [&](int index, int value) {
+            assert(write_graph(path, g));
+            fstream f(path, ios::in | ios::out | ios::binary);
+            f.seekp(sizeof(graph_file_header) + index * sizeof(int));
+            f.write((const char*) &value, sizeof value);
+        };
+        poke(2, 0);
+        assert(mapped_graph<int>(path) && !mapped_graph<int>(path, true));
+        poke(g.n + 1, -1);
+        assert(mapped_graph<int>(path) && !mapped_graph<int>(path, true));
+        poke(g.n + 2, g.n);
+        assert(mapped_graph<int>(path) && !mapped_graph<int>(path, true));
+        assert(write_graph(path, g));
+        assert(mapped_graph<int>(path, true));
+        remove(path);
+        assert(!mapped_graph<int>(path));
+    }
+
+    // Every priority queue gives the same distances and valid parents.
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 50, max_weight = t % 10 ? rand() % 100 : 0;
+        graph<int> g(n);
+        for (int k = rand() % (4 * n); k > 0; --k)
+            g.arc(rand() % n, rand() % n, rand() % (max_weight + 1));
+        auto expected = g.dijkstra(0).first;
+        auto check = [&](const pair<vector<int>, vector<int>>& res) {
+            assert(res.first == expected);
+            for (int x = 1; x < n; ++x) {
+                int p = res.second[x];
+                if (p == -1) {
+                    assert(expected[x] == g.infty);
+                    continue;
+                }
+                bool found = false;
+                for (auto& a : g.adj[p])
+                    found |= a.first == x && expected[p] + a.second == expected[x];
+                assert(found);
+            }
+        };
+        check(g.dijkstra<quad_heap<int>>(0));
+        check(g.dijkstra<radix_heap<int>>(0));
+        check(g.dijkstra<bucket_queue<int>>(0));
+    }
+
+    // Relabeled graphs give the same distances, up to renaming.
+    for (int t = 0; t < 50; ++t) {
+        int n = 1 + rand() % 50;
+        graph<int> g(n);
+        for (int k = rand() % (3 * n); k > 0; --k)
+            g.arc(rand() % n, rand() % n, rand() % 100);
+        for (auto o : {ordering::bfs, ordering::rcm, ordering::degree}) {
+            auto r = g.relabel(o);
+            auto dist = g.dijkstra(0).first, d = r.g.dijkstra(r.forward[0]).first;
+            for (int x = 0; x < n; ++x) {
+                assert(r.backward[r.forward[x]] == x);
+                assert(d[r.forward[x]] == dist[x]);
+                assert(r.g.adj[r.forward[x]].size() == g.adj[x].size());
+            }
+        }
+    }
+
+#ifdef BENCHMARK
+    benchmark_locality(2000);
+    benchmark_queues(1000);
+    benchmark_floyd_warshall(2000);
+    benchmark_johnsons(5000);
+    benchmark_mst(1000000, 4000000);
+    benchmark_point_to_point(1000, 100);
+    benchmark_workspace(1000, 100000);
+#endif
+
     cout << "All tests passed" << endl;
     return 0;
 }
@@ -0,0 +1,197 @@
+/*
+ * Subtree and root-path queries on a rooted tree in O(lg n), by
+ * flattening the tree with DFS push/pop times.
+ *
+ * order[v] := (push time, pop time) of node v, e.g. from
+ *             graph::push_pop_order(root); times are in [0, 2n)
+ *
+ * The subtree of v is exactly the nodes pushed in [push[v], pop[v]], so
+ * a value stored at each node's push time turns subtree queries into
+ * range queries. Pop times hold the identity.
+ *
+ * Root-path sums use the +/- delta trick: a value x at v is stored as +x
+ * at push[v] and -x at pop[v]. The prefix up to push[u] then cancels out
+ * every subtree finished before u was pushed, leaving u's ancestors.
+ *
+ * val := current value of each node
+ * sum := Fenwick tree of values at push times
+ * path := Fenwick tree of +/- deltas
+ * low := min segment tree of values at push times
+ */
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <cassert>
+using namespace std;
+using ll = long long;
+
+// Copied from data-structures/bit.cpp.
+template <typename T>
+struct bit {
+    int n;
+    vector<T> v;
+
+    // Valid range is [0,n] inclusive.
+    bit(int n): n(n+2), v(n+2) {}
+
+    void update(int i, T t) {
+        for (++i; i < n; i += i & -i) {
+            v[i] += t;
+        }
+    }
+
+    // Returns sum of [0,i] inclusive.
+    T query(int i) {
+        T sum = 0;
+        for (++i; i > 0; i -= i & -i)
+            sum += v[i];
+        return sum;
+    }
+
+    // Returns sum of [l,r] inclusive.
+    T query(int l, int r) {
+        return l <= r ? query(r) - query(l-1) : 0;
+    }
+};
+
+// Copied from data-structures/seg_tree.cpp.
+template <typename T, typename AssociativeOp>
+struct seg_tree {
+    T id;
+    AssociativeOp op;
+    int n;
+    vector<T> v;
+
+    seg_tree(int n, T id, AssociativeOp op)
+        : id(id), op(op), n(n), v(2*n, id) {}
+
+    // Set the value at index i in O(lg n).
+    void set(int i, T x) {
+        assert(0 <= i && i < n);
+        i += n;
+        v[i] = x;
+        for (i /= 2; i > 0; i /= 2) {
+            v[i] = op(v[2*i], v[2*i+1]);
+        }
+    }
+
+    // Fold over [l,r] in O(lg n).
+    T accumulate(int l, int r) {
+        assert(0 <= l && r < n);
+        T a = id, b = id;
+        for (l += n, r += n; l <= r; l /= 2, r /= 2) {
+            if (l % 2 == 1) a = op(a, v[l++]);
+            if (r % 2 == 0) b = op(v[r--], b);
+        }
+        return op(a, b);
+    }
+};
+
+// Copied from graphs/unweighted.cpp: graph::push_pop_order(root), with
+// graph::dfs inlined, on adjacency lists such as graph::adj.
+vector<pair<int,int>> push_pop_order(const vector<vector<int>>& adj, int root) {
+    int n = adj.size(), time = 0;
+    vector<pair<int,int>> order(n);
+    vector<int> next(n), q = {root};
+    vector<bool> visit(n);
+    order[root].first = time++;
+    visit[root] = true;
+    while (!q.empty()) {
+        int x = q.back();
+        int deg = adj[x].size();
+        if (next[x] == deg) {
+            q.pop_back();
+            order[x].second = time++;
+        } else while (next[x] < deg) {
+            int nbr = adj[x][next[x]++];
+            if (!visit[nbr]) {
+                q.push_back(nbr);
+                order[nbr].first = time++;
+                visit[nbr] = true;
+                break;
+            }
+        }
+    }
+    return order;
+}
+
+template <typename T>
+struct min_op {
+    T operator()(const T& a, const T& b) const { return min(a, b); }
+};
+
+template <typename T>
+struct tree_query {
+    vector<pair<int,int>> order;
+    vector<T> val;
+    bit<T> sum, path;
+    seg_tree<T, min_op<T>> low;
+
+    tree_query(const vector<pair<int,int>>& order)
+        : order(order), val(order.size()), sum(2 * order.size()),
+          path(2 * order.size()),
+          low(2 * order.size(), numeric_limits<T>::max(), min_op<T>())
+    {
+        for (auto& o : order)
+            low.set(o.first, 0);
+    }
+
+    void add(int v, T x) {
+        val[v] += x;
+        sum.update(order[v].first, x);
+        path.update(order[v].first, x);
+        path.update(order[v].second, -x);
+        low.set(order[v].first, val[v]);
+    }
+
+    T subtree_sum(int v) { return sum.query(order[v].first, order[v].second); }
+
+    T subtree_min(int v) { return low.accumulate(order[v].first, order[v].second); }
+
+    // Sum of values on the path from the root to v, inclusive.
+    T path_sum(int v) { return path.query(order[v].first); }
+};
+
+int main() {
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 100;
+        vector<int> parent(n, -1);
+        vector<vector<int>> adj(n);
+        for (int i = 1; i < n; ++i) {
+            parent[i] = t % 2 ? i - 1 : rand() % i;
+            adj[parent[i]].push_back(i);
+            adj[i].push_back(parent[i]);
+        }
+
+        tree_query<ll> q(push_pop_order(adj, 0));
+        vector<ll> val(n);
+        auto in_subtree = [&](int x, int r) {
+            for (; x != -1; x = parent[x])
+                if (x == r)
+                    return true;
+            return false;
+        };
+        for (int k = 0; k < 300; ++k) {
+            int v = rand() % n;
+            if (rand() % 2) {
+                ll x = rand() % 200 - 100;
+                val[v] += x;
+                q.add(v, x);
+                continue;
+            }
+            ll sum = 0, low = numeric_limits<ll>::max(), path = 0;
+            for (int u = 0; u < n; ++u)
+                if (in_subtree(u, v))
+                    sum += val[u], low = min(low, val[u]);
+            for (int u = v; u != -1; u = parent[u])
+                path += val[u];
+            assert(q.subtree_sum(v) == sum);
+            assert(q.subtree_min(v) == low);
+            assert(q.path_sum(v) == path);
+        }
+    }
+
+    cout << "All tests passed" << endl;
+    return 0;
+}
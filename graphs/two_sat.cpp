@@ -0,0 +1,278 @@
+/*
+ * 2-SAT in O(n + m) for n variables and m clauses.
+ * Literal 2*v is variable v, and literal 2*v+1 is its negation, so x^1
+ * negates literal x. A clause (a or b) adds implications ~a -> b and
+ * ~b -> a. The formula is satisfiable iff no variable shares a strongly
+ * connected component with its negation, and then setting each literal
+ * true iff its component comes later in topological order works.
+ *
+ * Clauses may be added between solves. A solve first repairs the previous
+ * assignment: for each new clause it violates, one of its literals is
+ * forced true along with everything that literal implies, flipping only
+ * literals that were false, so the cost is the new clauses plus the part
+ * of the graph that changes. Forced literals stay locked for the solve;
+ * if forcing either literal of a clause contradicts a locked one, the
+ * repair gives up, and the solve falls back to a full rebuild: pending
+ * implications are merged into the graph in one O(n + m) pass and every
+ * SCC recomputed. That fallback also decides unsatisfiability. Pending
+ * clauses are merged once they outnumber the graph's, to bound the side
+ * lists the repair searches.
+ *
+ * start, to := implication graph in compressed sparse row form
+ * pending := clauses added since the graph was last built
+ * checked := prefix of pending known to hold under value
+ * value[v] := satisfying value of variable v, after solve() is true
+ * comp[x] := SCC of literal x, numbered in reverse topological order
+ * side[x] := implications x -> y from pending clauses, during a repair
+ * lock[x] == stamp := literal x is forced true in the current repair
+ */
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <cassert>
+using namespace std;
+
+struct two_sat {
+    int n;
+    vector<int> start, to, comp, lock, trail;
+    vector<pair<int,int>> pending;
+    unordered_map<int, vector<int>> side;
+    vector<bool> value;
+    size_t checked = 0;
+    int stamp = 0;
+    bool solved = false, unsat = false;
+
+    two_sat(int n): n(n), start(2*n + 1), lock(2*n), value(n) {}
+
+    static int lit(int v, bool positive) { return 2*v + !positive; }
+
+    void either(int a, int b) { pending.emplace_back(a, b); }
+    void implies(int a, int b) { either(a^1, b); }
+    void must(int a) { either(a, a); }
+
+    bool holds(int x) const { return value[x/2] != (x & 1); }
+
+    bool solve() {
+        if (unsat)
+            return false;
+        if (solved && repair())
+            return true;
+        merge();
+        scc();
+        for (int v = 0; v < n; ++v) {
+            if (comp[2*v] == comp[2*v + 1])
+                return solved = false, unsat = true, false;
+            value[v] = comp[2*v] < comp[2*v + 1];
+        }
+        return solved = true;
+    }
+
+private:
+    // Fixes the violated clauses in pending[checked..] from the current
+    // value. Returns false if some clause cannot be fixed, leaving value
+    // for the full rebuild to overwrite.
+    bool repair() {
+        bool built = false;
+        ++stamp;
+        for (; checked < pending.size(); ++checked) {
+            auto c = pending[checked];
+            if (holds(c.first) || holds(c.second))
+                continue;
+            if (!built) {
+                side.clear();
+                for (auto& d : pending) {
+                    side[d.first^1].push_back(d.second);
+                    side[d.second^1].push_back(d.first);
+                }
+                built = true;
+            }
+            if (!force(c.first) && !force(c.second))
+                return solved = false;
+        }
+        if (2 * pending.size() > to.size())
+            merge();
+        return true;
+    }
+
+    // Locks x true and follows implications out of each literal that was
+    // false, then commits the flips. On reaching a literal whose negation
+    // is locked, unlocks this attempt's literals and returns false.
+    bool force(int x) {
+        trail.clear();
+        auto take = [&](int y) {
+            if (lock[y] == stamp)
+                return true;
+            if (lock[y^1] == stamp)
+                return false;
+            lock[y] = stamp;
+            trail.push_back(y);
+            return true;
+        };
+        bool ok = take(x);
+        for (size_t i = 0; ok && i < trail.size(); ++i) {
+            int y = trail[i];
+            if (holds(y))
+                continue;
+            for (int k = start[y]; ok && k < start[y+1]; ++k)
+                ok = take(to[k]);
+            auto it = side.find(y);
+            if (it != side.end())
+                for (int z : it->second)
+                    ok = ok && take(z);
+        }
+        for (int y : trail) {
+            if (!ok)
+                lock[y] = 0;
+            else
+                value[y/2] = !(y & 1);
+        }
+        return ok;
+    }
+
+    // Appends pending implications to the CSR arrays in one O(n + m) pass.
+    void merge() {
+        if (pending.empty())
+            return;
+        int lits = 2*n;
+        vector<int> deg(lits + 1);
+        for (auto& c : pending)
+            ++deg[(c.first^1) + 1], ++deg[(c.second^1) + 1];
+        vector<int> merged(to.size() + 2 * pending.size()), fill(lits + 1);
+        for (int x = 0; x < lits; ++x)
+            fill[x+1] = fill[x] + start[x+1] - start[x] + deg[x+1];
+        for (int x = 0; x < lits; ++x)
+            copy(to.begin() + start[x], to.begin() + start[x+1],
+                 merged.begin() + fill[x]);
+        vector<int> next(lits);
+        for (int x = 0; x < lits; ++x)
+            next[x] = fill[x] + start[x+1] - start[x];
+        for (auto& c : pending) {
+            merged[next[c.first^1]++] = c.second;
+            merged[next[c.second^1]++] = c.first;
+        }
+        start = fill;
+        to = move(merged);
+        pending.clear();
+        checked = 0;
+    }
+
+    // Pearce's single-pass, iterative variant of Tarjan's algorithm.
+    // comp[x] holds a DFS index, lowered to the lowest reachable index
+    // while x is open, then a component id counting down from 2n-1 once
+    // x's component is done, which is flipped at the end.
+    void scc() {
+        int lits = 2*n, index = 1, c = lits - 1;
+        comp.assign(lits, 0);
+        vector<int> it(lits), call, open;
+        vector<bool> root(lits);
+        auto begin = [&](int x) {
+            root[x] = true;
+            comp[x] = index++;
+            it[x] = start[x];
+            call.push_back(x);
+        };
+        auto finish_arc = [&](int x, int y) {
+            if (comp[y] < comp[x])
+                comp[x] = comp[y], root[x] = false;
+            ++it[x];
+        };
+        for (int s = 0; s < lits; ++s) {
+            if (comp[s])
+                continue;
+            begin(s);
+            while (!call.empty()) {
+                int x = call.back();
+                if (it[x] < start[x+1]) {
+                    int y = to[it[x]];
+                    if (comp[y])
+                        finish_arc(x, y);
+                    else
+                        begin(y);
+                    continue;
+                }
+                call.pop_back();
+                if (root[x]) {
+                    --index;
+                    while (!open.empty() && comp[x] <= comp[open.back()]) {
+                        comp[open.back()] = c;
+                        open.pop_back();
+                        --index;
+                    }
+                    comp[x] = c--;
+                } else {
+                    open.push_back(x);
+                }
+                if (!call.empty())
+                    finish_arc(call.back(), x);
+            }
+        }
+        for (auto& x : comp)
+            x = lits - 1 - x;
+    }
+};
+
+int main() {
+    two_sat s(3);
+    s.either(two_sat::lit(0, true), two_sat::lit(1, true));
+    s.either(two_sat::lit(0, false), two_sat::lit(1, true));
+    s.must(two_sat::lit(2, false));
+    assert(s.solve());
+    assert(s.value[1] && !s.value[2]);
+    s.implies(two_sat::lit(1, true), two_sat::lit(2, true));
+    assert(!s.solve());
+    s.must(two_sat::lit(0, true));
+    assert(!s.solve());
+
+    // Incremental solves against brute force.
+    for (int t = 0; t < 300; ++t) {
+        int n = 1 + rand() % 8;
+        two_sat s(n);
+        vector<pair<int,int>> clauses;
+        bool sat = true;
+        for (int k = 0; k < 3 * n && sat; ++k) {
+            int a = rand() % (2*n), b = rand() % (2*n);
+            s.either(a, b);
+            clauses.emplace_back(a, b);
+            sat = false;
+            for (int mask = 0; mask < 1 << n && !sat; ++mask) {
+                auto holds = [&](int x) { return (mask >> x/2 & 1) != (x & 1); };
+                sat = all_of(clauses.begin(), clauses.end(),
+                             [&](const pair<int,int>& c) {
+                                 return holds(c.first) || holds(c.second);
+                             });
+            }
+            assert(s.solve() == sat);
+            if (sat)
+                for (auto& c : clauses)
+                    assert(s.holds(c.first) || s.holds(c.second));
+        }
+    }
+
+    // Large chain of implications x0 -> x1 -> ... -> x(n-1), then ~x(n-1).
+    int n = 1000000;
+    two_sat big(n);
+    for (int v = 0; v + 1 < n; ++v)
+        big.implies(two_sat::lit(v, true), two_sat::lit(v + 1, true));
+    big.must(two_sat::lit(n - 1, false));
+    assert(big.solve());
+    assert(!big.value[0]);
+    for (int v = 0; v < n; ++v)
+        big.must(two_sat::lit(v, false)); // Already holds, no rebuild.
+    assert(big.solve() && big.pending.size() == size_t(n));
+
+    // A violated clause is repaired by propagation, without a rebuild.
+    two_sat chain(n);
+    for (int v = 0; v + 1 < n; ++v)
+        chain.implies(two_sat::lit(v, true), two_sat::lit(v + 1, true));
+    assert(chain.solve());
+    chain.must(two_sat::lit(0, true));
+    assert(chain.solve() && chain.pending.size() == 1);
+    for (int v = 0; v < n; ++v)
+        assert(chain.value[v]);
+    chain.must(two_sat::lit(n - 1, false)); // Conflicts: falls back, unsat.
+    assert(!chain.solve());
+
+    cout << "All tests passed" << endl;
+    return 0;
+}
@@ -1,50 +1,158 @@
 /*
- * A graph data structure and various algorithms.
+ * Graph data structures and various algorithms.
  * All traversals are non-recursive.
+ *
+ * graph := mutable adjacency lists, one vector per node
+ * csr_graph := immutable compressed sparse rows, built in O(n + m)
+ * mapped_graph := read-only CSR view of a binary graph file, via mmap
+ * graph_base := algorithms shared by every representation
+ *
  * n := number of nodes
+ * traversal := caller-owned scratch space for dfs and bfs
  * counter := auxiliary counter for traversal isolation
  * visit := auxiliary array for tracking visited nodes
  * next := auxiliary array for tracking next DFS child to visit
  * p := parent node
  * x := current node
  * nbr := neighbor of the current node
+ * nbrs(x) := random-access range over the neighbors of node x
  * cc := connected components
- * scc := strongly connected components
- * lca := lowest common ancestor
+ * parallel_bfs := direction-optimizing BFS (Beamer et al.) for symmetric
+ *                 graphs; returns (dist, parent), -1 where unreachable
+ * scc := strongly connected components, numbered in topological order
+ * condensation := DAG of strongly connected components
+ * topological_levels := Kahn's algorithm; level i holds the nodes whose
+ *                       longest incoming path has i arcs, so each level is
+ *                       an antichain that can be processed in parallel
+ * reachability := transitive closure over the condensation, O(1) queries
+ * biconnected := articulation points, bridges, 2-edge-connected and
+ *                biconnected components, and the block-cut tree of an
+ *                undirected graph, from one O(n + m) low-link pass
+ * vertex_order := node order for cache locality: BFS order, reverse
+ *                 Cuthill-McKee (bandwidth reduction), or by degree
+ * relabel := copy of the graph with node i renamed forward[i], sorted
+ *            neighbor lists, so traversals touch nearby memory
+ * lca := lowest common ancestor, online in O(1) per query after
+ *        O(n lg n) preprocessing, or offline in O((n + q) a(n)) total
  */
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <vector>
-#include <stack>
-#include <queue>
 #include <algorithm>
+#include <functional>
 #include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <cassert>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
-void noop(int p, int x) {}
+void noop(int, int) {}
 
-struct graph {
-    int n;
-    vector<vector<int>> adj;
-    mutable int counter;
-    mutable vector<int> visit, next;
+struct graph;
+struct csr_graph;
+struct biconnectivity;
 
-    graph(int n): n(n), adj(n), counter(0), visit(n), next(n) {}
+// Answers LCA queries in O(1) with a sparse table over an Euler tour.
+// Preprocessing is O(n lg n) time and memory.
+// first[x] := index of the first occurrence of node x in the tour
+// sp[k][i] := shallowest node in tour[i..i+2^k)
+struct lca_table {
+    vector<int> depth, first;
+    vector<vector<int>> sp;
 
-    void arc (int i, int j) { adj[i].emplace_back(j); }
-    void edge(int i, int j) { arc(i, j), arc(j, i); }
+    int shallower(int a, int b) const {
+        return depth[a] < depth[b] ? a : b;
+    }
+
+    int operator()(int a, int b) const {
+        int l = first[a], r = first[b];
+        if (l > r)
+            swap(l, r);
+        int k = __lg(r - l + 1);
+        return shallower(sp[k][l], sp[k][r - (1 << k) + 1]);
+    }
+};
+
+// Graphs hold no traversal state, so const methods are safe to call from
+// many threads at once. Give each thread its own traversal, and reuse it
+// to avoid reallocating; it grows to fit the largest graph it has seen.
+// Callbacks must not start another traversal with the same workspace.
+// q := DFS stack or BFS queue of (p, x) pairs
+struct traversal {
+    int counter = 0;
+    vector<int> visit, next;
+    vector<pair<int,int>> q;
+
+    void fit(int n) {
+        if ((int) visit.size() < n)
+            visit.resize(n), next.resize(n);
+    }
+};
+
+enum class ordering { bfs, rcm, degree };
+
+// A relabeled copy of a graph.
+// forward[x] := new id of old node x
+// backward[y] := old id of new node y
+template <typename Graph>
+struct relabeled {
+    Graph g;
+    vector<int> forward, backward;
+};
+
+// G must provide n and nbrs(x).
+// Traversals without a traversal argument allocate a fresh one.
+template <typename G>
+struct graph_base {
+    const G& self() const { return static_cast<const G&>(*this); }
 
     template <typename Pre, typename Post>
-    void dfs(int s, Pre pre, Post post) const;
+    void dfs(traversal& w, int s, Pre pre, Post post) const;
 
     template <typename Pre, typename Post>
-    void dfs(Pre pre, Post post) const;
+    void dfs(traversal& w, Pre pre, Post post) const;
 
     template <typename F>
-    void bfs(int s, F f) const;
+    void bfs(traversal& w, int s, F f) const;
 
     template <typename F>
-    void bfs(F f) const;
+    void bfs(traversal& w, F f) const;
+
+    template <typename Pre, typename Post>
+    void dfs(int s, Pre pre, Post post) const {
+        traversal w;
+        dfs(w, s, pre, post);
+    }
+
+    template <typename Pre, typename Post>
+    void dfs(Pre pre, Post post) const {
+        traversal w;
+        dfs(w, pre, post);
+    }
+
+    template <typename F>
+    void bfs(int s, F f) const {
+        traversal w;
+        bfs(w, s, f);
+    }
+
+    template <typename F>
+    void bfs(F f) const {
+        traversal w;
+        bfs(w, f);
+    }
+
+    pair<vector<int>, vector<int>>
+    parallel_bfs(int s, int threads = thread::hardware_concurrency()) const;
 
     template <typename F>
     void euler_tour(int s, F f) const;
@@ -53,37 +161,236 @@ struct graph {
 
     vector<int> scc() const;
 
+    csr_graph condensation(const vector<int>& scc) const;
+
+    vector<vector<int>> topological_levels() const;
+
     pair<bool, vector<bool>> bipartite() const;
 
+    biconnectivity biconnected() const;
+
     vector<int> articulation_points() const;
 
     graph dfs_tree(int root) const;
 
     vector<pair<int,int>> push_pop_order(int root) const;
 
-    function<int(int,int)> lca(int root) const;
+    vector<int> vertex_order(ordering o) const;
+
+    relabeled<graph> relabel(const vector<int>& backward) const;
+
+    relabeled<graph> relabel(ordering o) const;
+
+    lca_table lca(int root) const;
+
+    vector<int> lca(int root, const vector<pair<int,int>>& queries) const;
+};
+
+struct graph : graph_base<graph> {
+    int n;
+    vector<vector<int>> adj;
+
+    graph(int n): n(n), adj(n) {}
+
+    void arc (int i, int j) { adj[i].emplace_back(j); }
+    void edge(int i, int j) { arc(i, j), arc(j, i); }
+
+    const vector<int>& nbrs(int x) const { return adj[x]; }
+};
+
+struct csr_graph : graph_base<csr_graph> {
+    struct range {
+        const int *b, *e;
+        const int* begin() const { return b; }
+        const int* end() const { return e; }
+        int size() const { return e - b; }
+        int operator[](int i) const { return b[i]; }
+    };
+
+    int n;
+    vector<int> start, to;
+
+    // Counting sort by source node. Neighbors keep their input order.
+    csr_graph(int n, const vector<pair<int,int>>& arcs)
+        : n(n), start(n+1), to(arcs.size())
+    {
+        for (auto& a : arcs)
+            ++start[a.first + 1];
+        for (int i = 0; i < n; ++i)
+            start[i+1] += start[i];
+        vector<int> fill(start.begin(), start.end() - 1);
+        for (auto& a : arcs)
+            to[fill[a.first]++] = a.second;
+    }
+
+    csr_graph(const graph& g): n(g.n), start(n+1) {
+        for (int i = 0; i < n; ++i)
+            start[i+1] = start[i] + g.adj[i].size();
+        to.reserve(start[n]);
+        for (int i = 0; i < n; ++i)
+            to.insert(to.end(), g.adj[i].begin(), g.adj[i].end());
+    }
+
+    range nbrs(int x) const {
+        return {to.data() + start[x], to.data() + start[x+1]};
+    }
+};
+
+// Biconnectivity of an undirected graph, every edge stored as two arcs.
+// Parallel edges are distinct edges; self loops are ignored.
+// points := articulation points, in increasing order
+// bridges := bridges, as (DFS parent, child)
+// two_edge[x] := 2-edge-connected component of x
+// block_start, block_nodes := nodes of biconnected component b are
+//     block_nodes[block_start[b], block_start[b+1]); isolated nodes are in
+//     no block
+// tree := block-cut forest: node b < blocks is block b, node blocks + i is
+//     points[i], with an edge when the point lies in the block
+// tree_node[x] := node of x in tree: its point node, else its only block,
+//     or -1 if x is isolated
+struct biconnectivity {
+    int blocks = 0;
+    vector<int> points;
+    vector<pair<int,int>> bridges;
+    vector<int> two_edge, block_start, block_nodes, tree_node;
+    csr_graph tree = csr_graph(0, {});
+};
+
+// Binary graph file: a graph_file_header, then int32 start[n+1] and
+// to[m] as in csr_graph, then, if weight_size > 0, zero padding to a
+// multiple of 8 bytes and m weights. Native byte order.
+// shortest_path.cpp reads and writes the same format.
+struct graph_file_header {
+    char magic[8];
+    int64_t n, m;
+    int32_t weight_size, reserved;
+};
+
+const char graph_file_magic[8] = {'C','S','R','G','R','A','P','H'};
+
+// Writes g to path in the binary format. Returns false on failure.
+bool write_graph(const char* path, const csr_graph& g) {
+    graph_file_header h = {{}, g.n, g.start[g.n], 0, 0};
+    memcpy(h.magic, graph_file_magic, sizeof h.magic);
+    ofstream out(path, ios::binary);
+    out.write((const char*) &h, sizeof h);
+    out.write((const char*) g.start.data(), g.start.size() * sizeof(int));
+    out.write((const char*) g.to.data(), g.to.size() * sizeof(int));
+    return bool(out.flush());
+}
+
+// Converts a text edge list, "n m" followed by m arcs "i j", to a graph.
+// Write the result with write_graph to convert it to the binary format.
+csr_graph read_edge_list(istream& in) {
+    int n;
+    long long m;
+    in >> n >> m;
+    vector<pair<int,int>> arcs(m);
+    for (auto& a : arcs)
+        in >> a.first >> a.second;
+    return csr_graph(n, arcs);
+}
+
+// Maps a binary graph file read-only, without copying or parsing. Pages
+// load lazily as traversals touch them. Weights, if any, are ignored.
+// Evaluates to false if the file is missing or its header is malformed.
+// The arc arrays are trusted unless check is set, which rejects a start
+// that decreases or an arc outside [0, n) in O(n + m).
+struct mapped_graph : graph_base<mapped_graph> {
+    int n = 0;
+    const int *start = nullptr, *to = nullptr;
+    void* data = MAP_FAILED;
+    size_t bytes = 0;
+
+    mapped_graph(const char* path, bool check = false) {
+        int fd = open(path, O_RDONLY);
+        if (fd == -1)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(graph_file_header)) {
+            bytes = st.st_size;
+            data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (data == MAP_FAILED)
+            return;
+        // Header fields are untrusted: bound them by the file size with
+        // divisions, so a corrupt n or m cannot overflow the check.
+        auto h = (const graph_file_header*) data;
+        size_t ints = (bytes - sizeof *h) / sizeof(int);
+        start = (const int*) (h + 1);
+        if (memcmp(h->magic, graph_file_magic, sizeof h->magic) ||
+            h->n < 0 || h->n >= INT_MAX || h->m < 0 || h->m > INT_MAX ||
+            size_t(h->n) + 1 > ints || size_t(h->m) > ints - (h->n + 1) ||
+            start[0] != 0 || start[h->n] != h->m) {
+            munmap(data, bytes);
+            data = MAP_FAILED;
+            start = nullptr;
+            return;
+        }
+        n = h->n;
+        to = start + n + 1;
+        if (check && !valid_body()) {
+            munmap(data, bytes);
+            data = MAP_FAILED;
+            n = 0, start = to = nullptr;
+        }
+    }
+
+    mapped_graph(const mapped_graph&) = delete;
+    mapped_graph& operator=(const mapped_graph&) = delete;
+
+    ~mapped_graph() {
+        if (data != MAP_FAILED)
+            munmap(data, bytes);
+    }
+
+    // Whether start is non-decreasing and every arc stays in [0, n).
+    bool valid_body() const {
+        for (int x = 0; x < n; ++x)
+            if (start[x] > start[x+1])
+                return false;
+        for (int i = 0; i < start[n]; ++i)
+            if (to[i] < 0 || to[i] >= n)
+                return false;
+        return true;
+    }
+
+    explicit operator bool() const { return data != MAP_FAILED; }
+
+    csr_graph::range nbrs(int x) const {
+        return {to + start[x], to + start[x+1]};
+    }
 };
 
+template <typename G>
 template <typename Pre, typename Post>
-void graph::dfs(int s, Pre pre, Post post) const {
-    ++counter;
+void graph_base<G>::dfs(traversal& w, int s, Pre pre, Post post) const {
+    const G& g = self();
+    w.fit(g.n);
+    int counter = ++w.counter;
+    auto& visit = w.visit;
+    auto& next = w.next;
+    auto& q = w.q;
     if (visit[s] == counter)
         return;
-    stack<pair<int,int>> q;
-    q.emplace(-1, s);
+    q.clear();
+    q.emplace_back(-1, s);
     pre(-1, s);
     visit[s] = counter;
     next[s] = 0;
     while (!q.empty()) {
         int p, x;
-        tie(p, x) = q.top();
-        if (next[x] == adj[x].size()) {
-            q.pop();
+        tie(p, x) = q.back();
+        auto nbrs = g.nbrs(x);
+        int deg = nbrs.size();
+        if (next[x] == deg) {
+            q.pop_back();
             post(p, x);
-        } else while (next[x] < adj[x].size()) {
-            int nbr = adj[x][next[x]++];
+        } else while (next[x] < deg) {
+            int nbr = nbrs[next[x]++];
             if (visit[nbr] != counter) {
-                q.emplace(x, nbr);
+                q.emplace_back(x, nbr);
                 pre(x, nbr);
                 visit[nbr] = counter;
                 next[nbr] = 0;
@@ -93,175 +400,755 @@ void graph::dfs(int s, Pre pre, Post post) const {
     }
 }
 
+template <typename G>
 template <typename Pre, typename Post>
-void graph::dfs(Pre pre, Post post) const {
-    for (int i = 0; i < n; ++i) {
-        if (i) --counter;
-        dfs(i, pre, post);
+void graph_base<G>::dfs(traversal& w, Pre pre, Post post) const {
+    for (int i = 0; i < self().n; ++i) {
+        if (i) --w.counter;
+        dfs(w, i, pre, post);
     }
 }
 
+template <typename G>
 template <typename F>
-void graph::bfs(int s, F f) const {
-    ++counter;
+void graph_base<G>::bfs(traversal& w, int s, F f) const {
+    const G& g = self();
+    w.fit(g.n);
+    int counter = ++w.counter;
+    auto& visit = w.visit;
+    auto& q = w.q;
     if (visit[s] == counter)
         return;
-    queue<pair<int,int>> q;
-    q.emplace(-1, s);
+    q.clear();
+    q.emplace_back(-1, s);
     visit[s] = counter;
-    while (!q.empty()) {
+    for (size_t head = 0; head < q.size(); ++head) {
         int p, x;
-        tie(p, x) = q.front();
-        q.pop();
+        tie(p, x) = q[head];
         f(p, x);
-        for (auto nbr : adj[x]) {
+        for (auto nbr : g.nbrs(x)) {
             if (visit[nbr] != counter) {
-                q.emplace(x, nbr);
+                q.emplace_back(x, nbr);
                 visit[nbr] = counter;
             }
         }
     }
 }
 
+template <typename G>
 template <typename F>
-void graph::bfs(F f) const {
-    for (int i = 0; i < n; ++i) {
-        if (i) --counter;
-        bfs(i, f);
+void graph_base<G>::bfs(traversal& w, F f) const {
+    for (int i = 0; i < self().n; ++i) {
+        if (i) --w.counter;
+        bfs(w, i, f);
     }
 }
 
+// Runs f(t) for t in [0, threads) on separate threads.
 template <typename F>
-void graph::euler_tour(int s, F f) const {
-    auto pre  = [&](int p, int x) { if (p != -1) f(p); };
-    auto post = [&](int p, int x) { f(x); };
+void parallel_for(int threads, F f) {
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.emplace_back(f, t);
+    f(0);
+    for (auto& th : pool)
+        th.join();
+}
+
+template <typename G>
+pair<vector<int>, vector<int>>
+graph_base<G>::parallel_bfs(int s, int threads) const {
+    // Top-down steps scan out of the frontier list and claim nodes with a
+    // CAS on parent. Bottom-up steps scan unvisited nodes for a parent in
+    // the frontier bitmap, which requires nbrs(x) to also be the in-arcs.
+    // Each thread owns a 64-aligned block of nodes there, so no CAS needed.
+    // alpha, beta := direction switching thresholds from the paper
+    const G& g = self();
+    const int n = g.n, words = (n + 63) / 64, alpha = 14, beta = 24;
+    threads = max(1, threads);
+    vector<int> dist(n, -1), parent(n, -1);
+    vector<uint64_t> front(words), next_front(words);
+    vector<int> frontier = {s};
+    vector<vector<int>> local(threads);
+    vector<long long> local_deg(threads);
+    dist[s] = 0, parent[s] = s;
+
+    long long m_u = 0; // Arcs out of unvisited nodes.
+    for (int i = 0; i < n; ++i)
+        m_u += g.nbrs(i).size();
+    long long m_f = g.nbrs(s).size(), n_f = 1;
+    bool bottom_up = false;
+
+    auto chunk = [&](int t, long long size, int align) {
+        long long per = (size + threads - 1) / threads;
+        per = (per + align - 1) / align * align;
+        return make_pair(min(size, t * per), min(size, (t + 1) * per));
+    };
+
+    for (int d = 1; n_f > 0; ++d) {
+        m_u -= m_f;
+        if (!bottom_up && m_f > m_u / alpha) {
+            bottom_up = true;
+            fill(front.begin(), front.end(), 0);
+            for (int x : frontier)
+                front[x / 64] |= uint64_t(1) << (x % 64);
+        } else if (bottom_up && n_f < n / beta) {
+            bottom_up = false;
+            frontier.clear();
+            for (int x = 0; x < n; ++x)
+                if (front[x / 64] >> (x % 64) & 1)
+                    frontier.push_back(x);
+        }
+
+        parallel_for(threads, [&](int t) {
+            local[t].clear();
+            local_deg[t] = 0;
+            if (bottom_up) {
+                auto r = chunk(t, n, 64);
+                for (int x = r.first; x < r.second; ++x) {
+                    if (x % 64 == 0)
+                        next_front[x / 64] = 0;
+                    if (parent[x] != -1)
+                        continue;
+                    for (auto nbr : g.nbrs(x)) {
+                        if (front[nbr / 64] >> (nbr % 64) & 1) {
+                            parent[x] = nbr, dist[x] = d;
+                            next_front[x / 64] |= uint64_t(1) << (x % 64);
+                            local[t].push_back(x);
+                            local_deg[t] += g.nbrs(x).size();
+                            break;
+                        }
+                    }
+                }
+            } else {
+                auto r = chunk(t, frontier.size(), 1);
+                for (long long i = r.first; i < r.second; ++i) {
+                    int x = frontier[i];
+                    for (auto nbr : g.nbrs(x)) {
+                        atomic_ref<int> p(parent[nbr]);
+                        int none = -1;
+                        if (p.load(memory_order_relaxed) == -1 &&
+                            p.compare_exchange_strong(none, x)) {
+                            dist[nbr] = d;
+                            local[t].push_back(nbr);
+                            local_deg[t] += g.nbrs(nbr).size();
+                        }
+                    }
+                }
+            }
+        });
+
+        if (bottom_up)
+            swap(front, next_front);
+        frontier.clear();
+        m_f = n_f = 0;
+        for (int t = 0; t < threads; ++t) {
+            if (!bottom_up)
+                frontier.insert(frontier.end(), local[t].begin(), local[t].end());
+            n_f += local[t].size();
+            m_f += local_deg[t];
+        }
+    }
+
+    parent[s] = -1;
+    return make_pair(dist, parent);
+}
+
+template <typename G>
+template <typename F>
+void graph_base<G>::euler_tour(int s, F f) const {
+    auto pre  = [&](int p, int) { if (p != -1) f(p); };
+    auto post = [&](int, int x) { f(x); };
     dfs(s, pre, post);
 }
 
-int graph::cc() const {
+template <typename G>
+int graph_base<G>::cc() const {
     int count = 0;
-    bfs([&](int p, int x) { if (p == -1) ++count; });
+    bfs([&](int p, int) { if (p == -1) ++count; });
     return count;
 }
 
-graph graph::dfs_tree(int root) const {
-    graph g(n);
+template <typename G>
+graph graph_base<G>::dfs_tree(int root) const {
+    graph g(self().n);
     dfs(root, noop, [&](int p, int x) { if (p != -1) g.arc(p, x); });
     return g;
 }
 
-pair<bool, vector<bool>> graph::bipartite() const {
-    vector<bool> color(n);
+template <typename G>
+pair<bool, vector<bool>> graph_base<G>::bipartite() const {
+    const G& g = self();
+    vector<bool> color(g.n);
     bfs([&](int p, int x) {
         color[x] = p == -1 ? false : !color[p];
     });
     bool ok = true;
-    for (int i = 0; i < n; ++i)
-        for (auto nbr : adj[i])
+    for (int i = 0; i < g.n; ++i)
+        for (auto nbr : g.nbrs(i))
             ok &= color[i] != color[nbr];
     return make_pair(ok, color);
 }
 
-vector<int> graph::articulation_points() const {
-    // To find bridges, must also check for cliques of size 2.
-    vector<int> parent(n), dist(n), low(n);
-    vector<int> points;
+// Iterative Hopcroft-Tarjan. Nodes are stacked when first visited; when
+// child x of p finishes with low[x] >= tin[p], the nodes above and
+// including x, plus p, form a block. With low[x] > tin[p] the edge p-x is
+// a bridge and the nodes above and including x on a second stack form a
+// 2-edge-connected component. Only the first arc back to the parent is
+// skipped, so a parallel edge counts as a back edge.
+template <typename G>
+biconnectivity graph_base<G>::biconnected() const {
+    const G& g = self();
+    int n = g.n, time = 0;
+    biconnectivity r;
+    r.two_edge.assign(n, -1);
+    r.tree_node.assign(n, -1);
+    r.block_start.push_back(0);
+    // tin[x] := DFS discovery time, from 1; low[x] := lowest tin reachable
+    // from x's subtree by one back edge
+    // cut[x] := number of blocks completed below x
+    vector<int> tin(n), low(n), parent(n, -1), it(n), cut(n), call, nodes, edges;
+    vector<bool> skipped(n);
+    int two_edge = 0;
 
-    auto pre = [&](int p, int x) {
+    auto begin = [&](int x, int p) {
+        tin[x] = low[x] = ++time;
         parent[x] = p;
-        dist[x] = p == -1 ? 1 : dist[p] + 1;
+        call.push_back(x);
+        nodes.push_back(x);
+        edges.push_back(x);
+    };
+    auto pop_two_edge = [&](int x) {
+        int y;
+        do {
+            y = edges.back();
+            edges.pop_back();
+            r.two_edge[y] = two_edge;
+        } while (y != x);
+        ++two_edge;
     };
 
-    auto post = [&](int p, int x) {
-        if (p == -1) {
-            // Root vertex is an articulation point if it has
-            // more than one DFS child.
-            int deg = 0;
-            for (auto nbr : adj[x])
-                if (parent[nbr] == x)
-                    ++deg;
-            if (deg > 1) {
-                points.push_back(x);
+    for (int s = 0; s < n; ++s) {
+        if (tin[s])
+            continue;
+        begin(s, -1);
+        while (!call.empty()) {
+            int x = call.back();
+            auto nbrs = g.nbrs(x);
+            if (it[x] < (int) nbrs.size()) {
+                int nbr = nbrs[it[x]++];
+                if (nbr == parent[x] && !skipped[x])
+                    skipped[x] = true;
+                else if (tin[nbr])
+                    low[x] = min(low[x], tin[nbr]);
+                else
+                    begin(nbr, x);
+                continue;
             }
-        } else {
-            // Non-root vertex x is an articulation point if some
-            // DFS child nbr exists with low[nbr] >= dist[x].
-            low[x] = dist[x];
-            for (auto nbr : adj[x]) {
-                if (nbr != p)
-                    low[x] = min(low[x], dist[nbr]);
-                if (parent[nbr] == x) {
-                    low[x] = min(low[x], low[nbr]);
-                    if (low[nbr] >= dist[x]) {
-                        points.push_back(x);
-                    }
-                }
+            call.pop_back();
+            int p = parent[x];
+            if (p == -1) {
+                pop_two_edge(x);
+                nodes.pop_back();
+                continue;
+            }
+            low[p] = min(low[p], low[x]);
+            if (low[x] > tin[p]) {
+                r.bridges.emplace_back(p, x);
+                pop_two_edge(x);
             }
+            if (low[x] >= tin[p]) {
+                int y;
+                do {
+                    y = nodes.back();
+                    nodes.pop_back();
+                    r.block_nodes.push_back(y);
+                    r.tree_node[y] = r.blocks;
+                } while (y != x);
+                r.block_nodes.push_back(p);
+                r.tree_node[p] = r.blocks++;
+                r.block_start.push_back(r.block_nodes.size());
+                ++cut[p];
+            }
+        }
+    }
+
+    // A root is a point with two or more blocks below it, any other node
+    // with one or more.
+    vector<pair<int,int>> arcs;
+    for (int x = 0; x < n; ++x)
+        if (cut[x] > (parent[x] == -1))
+            r.tree_node[x] = r.blocks + r.points.size(), r.points.push_back(x);
+    for (int b = 0; b < r.blocks; ++b)
+        for (int i = r.block_start[b]; i < r.block_start[b+1]; ++i) {
+            int t = r.tree_node[r.block_nodes[i]];
+            if (t >= r.blocks)
+                arcs.emplace_back(b, t), arcs.emplace_back(t, b);
         }
+    r.tree = csr_graph(r.blocks + r.points.size(), arcs);
+    return r;
+}
+
+template <typename G>
+vector<int> graph_base<G>::articulation_points() const {
+    return biconnected().points;
+}
+
+template <typename G>
+vector<int> graph_base<G>::scc() const {
+    // Pearce's single-pass variant of Tarjan's algorithm.
+    // rindex[x] := DFS index of x, lowered to the lowest index reachable
+    //              while x is open; c + 1 onward once its component is done
+    // root[x] := whether x is still the root of its component
+    // it[x] := next neighbor of x to visit
+    // open := nodes whose component is not yet done, in DFS order
+    const G& g = self();
+    int n = g.n, index = 1, c = n - 1;
+    vector<int> rindex(n), it(n), call, open;
+    vector<bool> root(n);
+
+    auto begin = [&](int x) {
+        root[x] = true;
+        rindex[x] = index++;
+        it[x] = 0;
+        call.push_back(x);
+    };
+    auto finish_arc = [&](int x, int nbr) {
+        if (rindex[nbr] < rindex[x])
+            rindex[x] = rindex[nbr], root[x] = false;
+        ++it[x];
     };
 
-    dfs(pre, post);
-    sort(points.begin(), points.end());
-    points.erase(unique(points.begin(), points.end()), points.end());
-    return points;
+    for (int s = 0; s < n; ++s) {
+        if (rindex[s])
+            continue;
+        begin(s);
+        while (!call.empty()) {
+            int x = call.back();
+            auto nbrs = g.nbrs(x);
+            if (it[x] < (int) nbrs.size()) {
+                int nbr = nbrs[it[x]];
+                if (rindex[nbr])
+                    finish_arc(x, nbr);
+                else
+                    begin(nbr);
+                continue;
+            }
+            call.pop_back();
+            if (root[x]) {
+                --index;
+                while (!open.empty() && rindex[x] <= rindex[open.back()]) {
+                    rindex[open.back()] = c;
+                    open.pop_back();
+                    --index;
+                }
+                rindex[x] = c--;
+            } else {
+                open.push_back(x);
+            }
+            if (!call.empty())
+                finish_arc(call.back(), x);
+        }
+    }
+
+    // Components finish in reverse topological order.
+    for (auto& r : rindex)
+        r -= c + 1;
+    return rindex;
 }
 
-vector<int> graph::scc() const {
-    vector<int> q(n);
-    int idx = n;
-    dfs(noop, [&](int p, int x) { q[--idx] = x; });
-    graph transpose(n);
-    for (int i = 0; i < n; ++i)
-        for (auto nbr : adj[i])
-            transpose.arc(nbr, i);
-    vector<int> res(n, -1);
-    for (int i = 0; i < n; ++i) {
-        if (i) --transpose.counter; // Keep marked nodes marked.
-        transpose.bfs(q[i], [&](int p, int x) { res[x] = q[i]; });
+template <typename G>
+csr_graph graph_base<G>::condensation(const vector<int>& scc) const {
+    // Visits nodes grouped by component; last[c] dedups arcs out of c.
+    const G& g = self();
+    int k = 0;
+    for (auto c : scc)
+        k = max(k, c + 1);
+    vector<int> start(k+1), order(g.n), last(k, -1);
+    for (auto c : scc)
+        ++start[c + 1];
+    for (int c = 0; c < k; ++c)
+        start[c+1] += start[c];
+    for (int x = 0; x < g.n; ++x)
+        order[start[scc[x]]++] = x;
+
+    vector<pair<int,int>> arcs;
+    for (auto x : order)
+        for (auto nbr : g.nbrs(x))
+            if (scc[nbr] != scc[x] && last[scc[nbr]] != scc[x])
+                last[scc[nbr]] = scc[x], arcs.emplace_back(scc[x], scc[nbr]);
+    return csr_graph(k, arcs);
+}
+
+template <typename G>
+vector<vector<int>> graph_base<G>::topological_levels() const {
+    // Nodes on or after a cycle are left out.
+    const G& g = self();
+    vector<int> indeg(g.n);
+    for (int x = 0; x < g.n; ++x)
+        for (auto nbr : g.nbrs(x))
+            ++indeg[nbr];
+    vector<vector<int>> levels(1);
+    for (int x = 0; x < g.n; ++x)
+        if (!indeg[x])
+            levels[0].push_back(x);
+    while (!levels.back().empty()) {
+        vector<int> level;
+        for (auto x : levels.back())
+            for (auto nbr : g.nbrs(x))
+                if (!--indeg[nbr])
+                    level.push_back(nbr);
+        levels.push_back(move(level));
     }
-    return res;
+    levels.pop_back();
+    return levels;
 }
 
-vector<pair<int,int>> graph::push_pop_order(int root) const {
-    vector<pair<int,int>> order(n);
+template <typename G>
+vector<pair<int,int>> graph_base<G>::push_pop_order(int root) const {
+    vector<pair<int,int>> order(self().n);
     int i = 0;
-    auto pre  = [&](int p, int x) { order[x].first  = i++; };
-    auto post = [&](int p, int x) { order[x].second = i++; };
+    auto pre  = [&](int, int x) { order[x].first  = i++; };
+    auto post = [&](int, int x) { order[x].second = i++; };
     dfs(root, pre, post);
     return order;
 }
 
-function<int(int,int)> graph::lca(int root) const {
-    int log = 0;
-    while (1 << log < n)
-        ++log;
+// Returns the old ids in their new order. BFS and RCM restart from the
+// lowest unvisited id and lowest-degree unvisited node respectively; RCM
+// also visits neighbors by increasing degree and then reverses the order,
+// which keeps arcs of symmetric graphs close to the diagonal. Degree order
+// puts high-degree hubs first, next to each other.
+template <typename G>
+vector<int> graph_base<G>::vertex_order(ordering o) const {
+    const G& g = self();
+    vector<int> deg(g.n), by(g.n), order;
+    for (int x = 0; x < g.n; ++x)
+        deg[x] = g.nbrs(x).size(), by[x] = x;
+    auto lower = [&](int a, int b) { return deg[a] < deg[b]; };
+    if (o == ordering::degree) {
+        stable_sort(by.begin(), by.end(), [&](int a, int b) { return deg[a] > deg[b]; });
+        return by;
+    }
+    if (o == ordering::rcm)
+        stable_sort(by.begin(), by.end(), lower);
+    vector<bool> seen(g.n);
+    order.reserve(g.n);
+    for (auto s : by) {
+        if (seen[s])
+            continue;
+        seen[s] = true;
+        order.push_back(s);
+        for (size_t i = order.size() - 1; i < order.size(); ++i) {
+            size_t first = order.size();
+            for (auto nbr : g.nbrs(order[i]))
+                if (!seen[nbr])
+                    seen[nbr] = true, order.push_back(nbr);
+            if (o == ordering::rcm)
+                stable_sort(order.begin() + first, order.end(), lower);
+        }
+    }
+    if (o == ordering::rcm)
+        reverse(order.begin(), order.end());
+    return order;
+}
 
-    // dp[k][i] := (2^k)th parent of node i, or -1 if none.
-    vector<vector<int>> dp(log + 1, vector<int>(n, -1));
-    bfs(root, [&](int p, int x) { dp[0][x] = p; });
+template <typename G>
+relabeled<graph> graph_base<G>::relabel(const vector<int>& backward) const {
+    const G& g = self();
+    relabeled<graph> r{graph(g.n), vector<int>(g.n), backward};
+    for (int y = 0; y < g.n; ++y)
+        r.forward[backward[y]] = y;
+    for (int y = 0; y < g.n; ++y) {
+        auto& adj = r.g.adj[y];
+        adj.reserve(g.nbrs(backward[y]).size());
+        for (auto nbr : g.nbrs(backward[y]))
+            adj.push_back(r.forward[nbr]);
+        sort(adj.begin(), adj.end());
+    }
+    return r;
+}
+
+template <typename G>
+relabeled<graph> graph_base<G>::relabel(ordering o) const {
+    return relabel(vertex_order(o));
+}
+
+template <typename G>
+lca_table graph_base<G>::lca(int root) const {
+    lca_table t;
+    t.depth.assign(self().n, 0);
+    t.first.assign(self().n, -1);
+    vector<int> tour;
+    auto pre = [&](int p, int x) {
+        if (p != -1) {
+            t.depth[x] = t.depth[p] + 1;
+            tour.push_back(p);
+        }
+        t.first[x] = tour.size();
+    };
+    auto post = [&](int, int x) { tour.push_back(x); };
+    dfs(root, pre, post);
+
+    int m = tour.size(), log = 0;
+    while (2 << log <= m)
+        ++log;
+    t.sp.assign(log + 1, tour);
     for (int k = 1; k <= log; ++k)
-        for (int i = 0; i < n; ++i)
-            if (dp[k-1][i] != -1)
-                dp[k][i] = dp[k-1][dp[k-1][i]];
+        for (int i = 0; i + (1 << k) <= m; ++i)
+            t.sp[k][i] = t.shallower(t.sp[k-1][i], t.sp[k-1][i + (1 << (k-1))]);
+    return t;
+}
 
-    vector<int> dist(n);
-    bfs(root, [&](int p, int x) {
-        dist[x] = p == -1 ? 0 : dist[p] + 1;
-    });
+template <typename G>
+vector<int> graph_base<G>::lca(int root,
+                               const vector<pair<int,int>>& queries) const {
+    // Tarjan's offline algorithm. When x is popped, anc[rep(y)] is the
+    // lowest ancestor of x that is also an ancestor of any popped node y.
+    // uf, rank := union-find over popped subtrees
+    // qs[qstart[x]..qstart[x+1]) := indices of queries involving node x
+    int n = self().n, q = queries.size();
+    vector<int> uf(n), rank(n), anc(n), ans(q, -1), qstart(n+1), qs(2*q);
+    vector<bool> done(n);
+    for (auto& e : queries)
+        ++qstart[e.first + 1], ++qstart[e.second + 1];
+    for (int i = 0; i < n; ++i)
+        qstart[i+1] += qstart[i];
+    vector<int> fill(qstart.begin(), qstart.end() - 1);
+    for (int i = 0; i < q; ++i)
+        qs[fill[queries[i].first]++] = i, qs[fill[queries[i].second]++] = i;
 
-    return [=](int a, int b) {
-        if (dist[a] < dist[b])
-            swap(a, b);
-        for (int k = log; k >= 0; --k)
-            if (dp[k][a] != -1 && dist[dp[k][a]] >= dist[b])
-                a = dp[k][a];
-        for (int k = log; k >= 0; --k)
-            if (dp[k][a] != dp[k][b])
-                a = dp[k][a], b = dp[k][b];
-        return a == b ? a : dp[0][a];
+    auto rep = [&](int i) {
+        while (uf[i] != i)
+            i = uf[i] = uf[uf[i]];
+        return i;
     };
+    auto pre = [&](int, int x) { uf[x] = anc[x] = x; };
+    auto post = [&](int p, int x) {
+        done[x] = true;
+        for (int k = qstart[x]; k < qstart[x+1]; ++k) {
+            int i = qs[k];
+            int y = queries[i].first ^ queries[i].second ^ x;
+            if (done[y])
+                ans[i] = anc[rep(y)];
+        }
+        if (p != -1) {
+            int a = rep(x), b = rep(p);
+            if (rank[a] > rank[b])
+                swap(a, b);
+            uf[a] = b;
+            rank[b] += rank[a] == rank[b];
+            anc[b] = p;
+        }
+    };
+    dfs(root, pre, post);
+    return ans;
+}
+
+// Answers "can u reach v" in O(1) with one bitset row per SCC. Rows are
+// filled in reverse topological order, row[c] = {c} | row[d] over arcs
+// c -> d of the condensation, in O(k m / 64) time and k^2 / 8 bytes for
+// k SCCs. Since SCCs are numbered topologically, row c only has bits >= c.
+// For graphs too large for that, batch() answers queries offline, one
+// chunk of 64 * words target SCCs at a time, in O(k * words) memory.
+struct reachability {
+    vector<int> comp;
+    int k, words;
+    vector<uint64_t> bits;
+
+    template <typename G>
+    reachability(const G& g): comp(g.scc()) {
+        csr_graph dag = g.condensation(comp);
+        k = dag.n;
+        words = (k + 63) / 64;
+        bits.assign((size_t) k * words, 0);
+        closure(dag, 0, words, bits.data());
+    }
+
+    bool operator()(int u, int v) const {
+        int c = comp[v];
+        return bits[(size_t) comp[u] * words + c / 64] >> (c % 64) & 1;
+    }
+
+    // Fills rows for sources [0, k) and targets [64 * lo, 64 * hi).
+    static void closure(const csr_graph& dag, int lo, int hi, uint64_t* bits) {
+        int k = dag.n, w = hi - lo;
+        for (int c = min(k, 64 * hi) - 1; c >= 0; --c) {
+            uint64_t* row = bits + (size_t) c * w;
+            fill(row, row + w, 0);
+            int first = max(lo, c / 64);
+            if (c >= 64 * lo)
+                row[c / 64 - lo] |= uint64_t(1) << (c % 64);
+            for (auto d : dag.nbrs(c)) {
+                if (d >= 64 * hi)
+                    continue;
+                const uint64_t* other = bits + (size_t) d * w;
+                for (int i = first - lo; i < w; ++i)
+                    row[i] |= other[i];
+            }
+        }
+    }
+
+    template <typename G>
+    static vector<bool> batch(const G& g, const vector<pair<int,int>>& queries,
+                              int words = 1024) {
+        auto comp = g.scc();
+        csr_graph dag = g.condensation(comp);
+        int k = dag.n, chunks = (k + 64 * words - 1) / (64 * words);
+        vector<int> start(chunks + 1), order(queries.size());
+        for (auto& q : queries)
+            ++start[comp[q.second] / 64 / words + 1];
+        for (int i = 0; i < chunks; ++i)
+            start[i+1] += start[i];
+        vector<int> fill(start.begin(), start.end() - 1);
+        for (int i = 0; i < (int) queries.size(); ++i)
+            order[fill[comp[queries[i].second] / 64 / words]++] = i;
+
+        vector<bool> res(queries.size());
+        vector<uint64_t> bits((size_t) k * words);
+        for (int i = 0; i < chunks; ++i) {
+            int lo = i * words;
+            closure(dag, lo, lo + words, bits.data());
+            for (int j = start[i]; j < start[i+1]; ++j) {
+                int c = comp[queries[order[j]].first], d = comp[queries[order[j]].second];
+                res[order[j]] = bits[(size_t) c * words + d / 64 - lo] >> (d % 64) & 1;
+            }
+        }
+        return res;
+    }
+};
+
+#ifdef BENCHMARK
+#include <chrono>
+
+chrono::steady_clock::time_point now() { return chrono::steady_clock::now(); }
+
+// Seconds elapsed since t.
+double secs(chrono::steady_clock::time_point t) {
+    return chrono::duration<double>(now() - t).count();
+}
+
+// Xorshift generator, so benchmark inputs are the same on every platform.
+struct xorshift {
+    unsigned long long seed = 88172645463325252ull;
+    unsigned long long operator()() {
+        seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+        return seed;
+    }
+};
+
+// Compares memory and BFS throughput of graph and csr_graph on a random
+// graph. Compile with -DBENCHMARK; 1e8 arcs needs about 3 GB of memory.
+void benchmark(int n, long long m) {
+    vector<pair<int,int>> arcs(m);
+    xorshift next;
+    for (auto& a : arcs) {
+        auto r = next();
+        a = make_pair(r % n, (r >> 32) % n);
+    }
+
+    auto t = now();
+    graph g(n);
+    for (auto& a : arcs)
+        g.arc(a.first, a.second);
+    double g_build = secs(t);
+    size_t g_bytes = g.adj.capacity() * sizeof(vector<int>);
+    for (auto& v : g.adj)
+        g_bytes += v.capacity() * sizeof(int);
+
+    t = now();
+    csr_graph c(n, arcs);
+    double c_build = secs(t);
+    size_t c_bytes = (c.start.capacity() + c.to.capacity()) * sizeof(int);
+    arcs = vector<pair<int,int>>();
+
+    long long visited = 0;
+    t = now();
+    g.bfs(0, [&](int, int) { ++visited; });
+    double g_bfs = secs(t);
+    t = now();
+    c.bfs(0, [&](int, int) { ++visited; });
+    double c_bfs = secs(t);
+    t = now();
+    auto comp = c.scc();
+    double c_scc = secs(t);
+    int components = *max_element(comp.begin(), comp.end()) + 1;
+
+    cout << "n = " << n << ", m = " << m << ", reached = " << visited / 2 << endl;
+    cout << "graph:     " << g_bytes / (1 << 20) << " MiB, build "
+         << g_build << " s, bfs " << m / g_bfs / 1e6 << " M arcs/s" << endl;
+    cout << "csr_graph: " << c_bytes / (1 << 20) << " MiB, build "
+         << c_build << " s, bfs " << m / c_bfs / 1e6 << " M arcs/s, scc "
+         << c_scc << " s (" << components << " components)" << endl;
+
+    const char* path = "benchmark.graph";
+    write_graph(path, c);
+    t = now();
+    mapped_graph mapped(path);
+    double m_open = secs(t);
+    t = now();
+    mapped.bfs(0, [&](int, int) {});
+    double m_bfs = secs(t);
+    remove(path);
+    cout << "mapped_graph: open " << m_open * 1e3 << " ms, first bfs "
+         << m_bfs << " s" << endl;
 }
 
+// BFS throughput before and after relabeling two graphs whose input ids
+// carry no locality: a side x side grid, shaped like a road network, and a
+// preferential-attachment graph with a power-law degree distribution.
+void benchmark_locality(int side) {
+    int n = side * side;
+    xorshift next;
+    vector<int> id(n);
+    for (int i = 0; i < n; ++i)
+        id[i] = i;
+    for (int i = 1; i < n; ++i)
+        swap(id[i], id[next() % (i + 1)]);
+
+    graph grid(n), social(n);
+    for (int i = 0; i < n; ++i) {
+        if (i % side + 1 < side) grid.edge(id[i], id[i + 1]);
+        if (i + side < n) grid.edge(id[i], id[i + side]);
+    }
+    // Each new node links to 4 endpoints of earlier edges, so picks are
+    // proportional to degree.
+    vector<int> ends = {id[0], id[1]};
+    social.edge(id[0], id[1]);
+    for (int i = 2; i < n; ++i)
+        for (int k = 0; k < 4; ++k) {
+            int j = ends[next() % ends.size()];
+            social.edge(id[i], j);
+            ends.push_back(id[i]), ends.push_back(j);
+        }
+
+    for (auto* g : {&grid, &social}) {
+        long long arcs = 0;
+        for (auto& v : g->adj)
+            arcs += v.size();
+        auto run = [&](const char* name, const graph& h) {
+            traversal w;
+            h.bfs(w, [](int, int) {});
+            auto t = now();
+            h.bfs(w, [](int, int) {});
+            cout << "  " << name << ": bfs " << arcs / secs(t) / 1e6 << " M arcs/s" << endl;
+        };
+        cout << (g == &grid ? "grid" : "power law") << ", n = " << n
+             << ", m = " << arcs << endl;
+        run("input ", *g);
+        auto t = now();
+        auto r = g->relabel(ordering::bfs);
+        double build = secs(t);
+        run("bfs   ", r.g);
+        r = g->relabel(ordering::rcm);
+        run("rcm   ", r.g);
+        r = g->relabel(ordering::degree);
+        run("degree", r.g);
+        cout << "  relabel (bfs) " << build << " s" << endl;
+    }
+}
+#endif
+
 int main() {
     // Connected components and bipartite.
     graph g(7);
@@ -299,6 +1186,100 @@ int main() {
     g.edge(14,15);
     g.edge(14,16);
     assert(g.articulation_points() == vector<int>({2,4,5,6,12,14}));
+    assert(csr_graph(g).articulation_points() == g.articulation_points());
+
+    // Bridges, 2-edge-connected and biconnected components.
+    {
+        auto b = g.biconnected();
+        vector<pair<int,int>> bridges =
+            {{6,7}, {12,13}, {5,6}, {4,5}, {2,4}, {14,15}, {14,16}};
+        assert(b.bridges == bridges);
+        assert(b.two_edge[0] == b.two_edge[3] && b.two_edge[6] == b.two_edge[11]);
+        assert(b.two_edge[2] != b.two_edge[4] && b.two_edge[4] != b.two_edge[5]);
+        assert(b.blocks == 9 && b.tree.n == 15);
+        assert(b.tree.cc() == 2 && b.tree_node[12] == b.blocks + 4);
+        vector<int> block(b.block_nodes.begin() + b.block_start[b.tree_node[9]],
+                          b.block_nodes.begin() + b.block_start[b.tree_node[9] + 1]);
+        sort(block.begin(), block.end());
+        assert(block == vector<int>({6,8,9,10,11,12}));
+        g.edge(5,6);
+        assert(g.biconnected().bridges.size() == 6);
+    }
+
+    // Biconnectivity against brute force on random multigraphs.
+    for (int t = 0; t < 200; ++t) {
+        int n = 1 + rand() % 12, m = rand() % 20;
+        vector<pair<int,int>> edges;
+        for (int i = 0; i < m; ++i)
+            edges.emplace_back(rand() % n, rand() % n);
+        // Components without node v and edge e, or -1 for none.
+        auto components = [&](int v, int e) {
+            graph h(n);
+            for (int i = 0; i < m; ++i)
+                if (i != e && edges[i].first != v && edges[i].second != v)
+                    h.edge(edges[i].first, edges[i].second);
+            return h.cc() - (v != -1);
+        };
+        graph h(n);
+        for (auto& e : edges)
+            h.edge(e.first, e.second);
+        auto b = h.biconnected();
+        int cc = h.cc();
+
+        vector<int> points;
+        for (int v = 0; v < n; ++v)
+            if (components(v, -1) > cc)
+                points.push_back(v);
+        assert(b.points == points);
+
+        graph rest(n);
+        int bridges = 0;
+        for (int i = 0; i < m; ++i) {
+            if (components(-1, i) > cc)
+                ++bridges;
+            else
+                rest.edge(edges[i].first, edges[i].second);
+        }
+        assert((int) b.bridges.size() == bridges);
+        for (int x = 0; x < n; ++x)
+            for (int y = 0; y < n; ++y) {
+                bool same = false;
+                rest.bfs(x, [&](int, int z) { same |= z == y; });
+                assert(same == (b.two_edge[x] == b.two_edge[y]));
+            }
+
+        // Every edge lies in exactly one block, every block is connected
+        // with no articulation point, and the block-cut graph is a forest.
+        vector<vector<int>> in(n);
+        for (int k = 0; k < b.blocks; ++k)
+            for (int i = b.block_start[k]; i < b.block_start[k+1]; ++i)
+                in[b.block_nodes[i]].push_back(k);
+        for (auto& e : edges) {
+            if (e.first == e.second)
+                continue;
+            int common = 0;
+            for (auto k : in[e.first])
+                common += count(in[e.second].begin(), in[e.second].end(), k);
+            assert(common == 1);
+        }
+        for (int k = 0; k < b.blocks; ++k) {
+            vector<int> id(n, -1);
+            int size = 0;
+            for (int i = b.block_start[k]; i < b.block_start[k+1]; ++i)
+                id[b.block_nodes[i]] = size++;
+            graph block(size);
+            for (auto& e : edges)
+                if (e.first != e.second && id[e.first] != -1 && id[e.second] != -1)
+                    block.edge(id[e.first], id[e.second]);
+            assert(block.cc() == 1 && block.articulation_points().empty());
+        }
+        long long arcs = b.tree.start[b.tree.n];
+        int isolated = count(b.tree_node.begin(), b.tree_node.end(), -1);
+        assert(b.tree.n - arcs / 2 == cc - isolated);
+        for (int x = 0; x < n; ++x)
+            if (b.tree_node[x] != -1 && b.tree_node[x] < b.blocks)
+                assert(in[x] == vector<int>({b.tree_node[x]}));
+    }
 
     // Strongly-connected components.
     g = graph(8);
@@ -313,7 +1294,90 @@ int main() {
     g.edge(5,6);
     g.edge(2,3);
     g.edge(3,7);
-    assert(g.scc() == vector<int>({0,0,2,2,0,5,5,2}));
+    assert(g.scc() == vector<int>({0,0,1,1,0,2,2,1}));
+    assert(csr_graph(g).scc() == g.scc());
+    auto dag = g.condensation(g.scc());
+    assert(dag.n == 3 && dag.start == vector<int>({0,2,3,3}));
+    assert(dag.to == vector<int>({2,1,2}));
+
+    // Reachability index against BFS, including chunked batches.
+    for (int t = 0; t < 50; ++t) {
+        int n = 1 + rand() % 300, m = rand() % (2 * n);
+        graph a(n);
+        for (int i = 0; i < m; ++i)
+            a.arc(rand() % n, rand() % n);
+        reachability reach(a);
+        vector<pair<int,int>> queries;
+        vector<bool> expected;
+        for (int i = 0; i < n; ++i) {
+            vector<bool> seen(n);
+            a.bfs(i, [&](int, int x) { seen[x] = true; });
+            for (int j = 0; j < n; ++j) {
+                assert(reach(i, j) == seen[j]);
+                if (rand() % 4 == 0)
+                    queries.emplace_back(i, j), expected.push_back(seen[j]);
+            }
+        }
+        assert(reachability::batch(a, queries, 1) == expected);
+        assert(reachability::batch(csr_graph(a), queries) == expected);
+    }
+
+    // Topological levels.
+    g = graph(6);
+    g.arc(0,1);
+    g.arc(0,2);
+    g.arc(1,3);
+    g.arc(2,3);
+    g.arc(4,3);
+    g.arc(3,5);
+    assert(g.topological_levels()
+           == vector<vector<int>>({{0,4}, {1,2}, {3}, {5}}));
+    g.arc(5,1);
+    assert(g.topological_levels() == vector<vector<int>>({{0,4}, {2}}));
+
+    // SCCs match mutual reachability, and arcs never point backward.
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 30, m = rand() % 60;
+        graph a(n);
+        for (int i = 0; i < m; ++i)
+            a.arc(rand() % n, rand() % n);
+        auto comp = a.scc();
+        vector<vector<bool>> reach(n, vector<bool>(n));
+        for (int i = 0; i < n; ++i)
+            a.bfs(i, [&](int, int x) { reach[i][x] = true; });
+        for (int i = 0; i < n; ++i) {
+            for (auto nbr : a.adj[i])
+                assert(comp[i] <= comp[nbr]);
+            for (int j = 0; j < n; ++j)
+                assert((comp[i] == comp[j]) == (reach[i][j] && reach[j][i]));
+        }
+        auto dag = a.condensation(comp);
+        for (int c = 0; c < dag.n; ++c)
+            for (auto d : dag.nbrs(c))
+                assert(c < d);
+        vector<int> level(dag.n, -1);
+        int seen = 0;
+        auto levels = dag.topological_levels();
+        for (int i = 0; i < (int) levels.size(); ++i)
+            for (auto c : levels[i])
+                level[c] = i, ++seen;
+        assert(seen == dag.n);
+        for (int c = 0; c < dag.n; ++c) {
+            bool tight = level[c] == 0;
+            for (int d = 0; d < dag.n; ++d)
+                for (auto e : dag.nbrs(d))
+                    if (e == c)
+                        tight |= level[d] == level[c] - 1;
+            for (auto d : dag.nbrs(c))
+                assert(level[c] < level[d]);
+            assert(tight);
+        }
+        for (int i = 0; i < n; ++i)
+            for (auto nbr : a.adj[i])
+                if (comp[i] != comp[nbr])
+                    assert(count(dag.nbrs(comp[i]).begin(),
+                                 dag.nbrs(comp[i]).end(), comp[nbr]) == 1);
+    }
 
     // Lowest common ancestor.
     g = graph(8);
@@ -333,6 +1397,8 @@ int main() {
     assert(lca(1,4) == 1);
     assert(lca(4,1) == 1);
     assert(lca(0,7) == 0);
+    assert(g.lca(0, {{0,1}, {3,4}, {3,6}, {4,1}, {7,7}})
+           == vector<int>({0, 1, 0, 1, 7}));
 
     // Euler tour.
     vector<int> tour;
@@ -341,6 +1407,217 @@ int main() {
 
     // graph::push_pop_order tested on HackerRank, "The Story of a Tree."
 
+    // Direction-optimizing BFS matches serial BFS distances, and parents
+    // form a valid BFS tree, on sparse and low-diameter dense graphs.
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 300, m = rand() % (t % 2 ? 4 * n : n * n / 4 + 1);
+        graph a(n);
+        for (int i = 0; i < m; ++i)
+            a.edge(rand() % n, rand() % n);
+        int s = rand() % n;
+        vector<int> dist(n, -1);
+        a.bfs(s, [&](int p, int x) { dist[x] = p == -1 ? 0 : dist[p] + 1; });
+        for (int threads : {1, 2, 3, 8}) {
+            auto res = csr_graph(a).parallel_bfs(s, threads);
+            assert(res.first == dist);
+            for (int x = 0; x < n; ++x) {
+                int p = res.second[x];
+                if (x == s || dist[x] == -1) {
+                    assert(p == -1);
+                } else {
+                    assert(dist[p] == dist[x] - 1);
+                    assert(count(a.adj[p].begin(), a.adj[p].end(), x));
+                }
+            }
+        }
+    }
+
+    // Concurrent queries on one shared graph, one traversal per thread.
+    {
+        int n = 3000, sources = 16;
+        graph a(n), tree(n);
+        for (int i = 1; i < n; ++i) {
+            tree.edge(rand() % i, i);
+            if (rand() % 4)
+                a.edge(rand() % n, i);
+        }
+        const csr_graph c(a);
+        int components = c.cc();
+        vector<vector<int>> dist(sources, vector<int>(n, -1));
+        for (int s = 0; s < sources; ++s)
+            c.bfs(s, [&](int p, int x) {
+                dist[s][x] = p == -1 ? 0 : dist[s][p] + 1;
+            });
+        vector<pair<int,int>> queries;
+        for (int i = 0; i < n; ++i)
+            queries.emplace_back(i, rand() % n);
+        auto lca = tree.lca(0);
+        auto answers = tree.lca(0, queries);
+
+        parallel_for(8, [&](int t) {
+            traversal w;
+            vector<int> d(n);
+            for (int it = 0; it < 20; ++it) {
+                int s = (t + it) % sources;
+                fill(d.begin(), d.end(), -1);
+                c.bfs(w, s, [&](int p, int x) {
+                    d[x] = p == -1 ? 0 : d[p] + 1;
+                });
+                assert(d == dist[s]);
+                int order = 0;
+                c.dfs(w, s, [&](int, int x) { d[x] = order++; }, noop);
+                assert(order == count_if(dist[s].begin(), dist[s].end(),
+                                         [](int x) { return x != -1; }));
+                assert(c.cc() == components);
+                assert(tree.lca(0, queries) == answers);
+                auto mine = tree.lca(0);
+                for (auto& q : queries)
+                    assert(mine(q.first, q.second) == lca(q.first, q.second));
+            }
+        });
+    }
+
+    // Binary graph files round-trip through mmap.
+    {
+        const char* path = "unweighted.test.graph";
+        istringstream text("5 6\n0 1\n1 2\n2 0\n2 3\n3 4\n4 3\n");
+        csr_graph c = read_edge_list(text);
+        assert(write_graph(path, c));
+        mapped_graph m(path);
+        assert(m && m.n == 5);
+        for (int i = 0; i < 5; ++i)
+            assert(equal(m.nbrs(i).begin(), m.nbrs(i).end(),
+                         c.nbrs(i).begin(), c.nbrs(i).end()));
+        assert(m.scc() == vector<int>({0,0,0,1,1}));
+        assert(m.cc() == 1);
+        ofstream(path) << "not a graph file";
+        assert(!mapped_graph(path));
+        // Truncated, or with an arc count that overflows the size check.
+        assert(write_graph(path, c));
+        assert(truncate(path, sizeof(graph_file_header) + 8 * sizeof(int)) == 0);
+        assert(!mapped_graph(path));
+        assert(write_graph(path, c));
+        {
+            fstream f(path, ios::in | ios::out | ios::binary);
+            int64_t m = (int64_t(1) << 62) - 5;
+            f.seekp(offsetof(graph_file_header, m));
+            f.write((const char*) &m, sizeof m);
+        }
+        assert(!mapped_graph(path));
+        // A corrupt body passes the header checks unless check is set.
+        auto poke = [&](int index, int value) {
+            assert(write_graph(path, c));
+            fstream f(path, ios::in | ios::out | ios::binary);
+            f.seekp(sizeof(graph_file_header) + index * sizeof(int));
+            f.write((const char*) &value, sizeof value);
+        };
+        poke(2, 0);
+        assert(mapped_graph(path) && !mapped_graph(path, true));
+        poke(c.n + 1, -1);
+        assert(mapped_graph(path) && !mapped_graph(path, true));
+        poke(c.n + 2, c.n);
+        assert(mapped_graph(path) && !mapped_graph(path, true));
+        assert(write_graph(path, c));
+        assert(mapped_graph(path, true));
+        remove(path);
+        assert(!mapped_graph(path));
+    }
+
+    // CSR graph agrees with adjacency lists on random graphs.
+    for (int t = 0; t < 100; ++t) {
+        int n = 1 + rand() % 30, m = rand() % 60;
+        vector<pair<int,int>> arcs;
+        graph a(n);
+        for (int i = 0; i < m; ++i) {
+            int x = rand() % n, y = rand() % n;
+            arcs.emplace_back(x, y);
+            a.arc(x, y);
+        }
+        csr_graph c(n, arcs);
+        for (int i = 0; i < n; ++i)
+            assert(vector<int>(c.nbrs(i).begin(), c.nbrs(i).end()) == a.adj[i]);
+        assert(c.cc() == a.cc());
+        assert(c.scc() == a.scc());
+        assert(c.bipartite() == a.bipartite());
+        assert(c.articulation_points() == a.articulation_points());
+        assert(c.push_pop_order(0) == a.push_pop_order(0));
+        assert(c.dfs_tree(0).adj == a.dfs_tree(0).adj);
+
+        graph tree(n);
+        for (int i = 1; i < n; ++i)
+            tree.edge(rand() % i, i);
+        vector<int> parent(n, -1), depth(n);
+        tree.bfs(0, [&](int p, int x) {
+            parent[x] = p;
+            depth[x] = p == -1 ? 0 : depth[p] + 1;
+        });
+        auto lca = csr_graph(tree).lca(0);
+        vector<pair<int,int>> queries;
+        vector<int> expected;
+        for (int i = 0; i < n; ++i) {
+            int x = i, y = rand() % n;
+            queries.emplace_back(x, y);
+            while (x != y)
+                depth[x] < depth[y] ? y = parent[y] : x = parent[x];
+            assert(lca(i, queries.back().second) == x);
+            expected.push_back(x);
+        }
+        assert(tree.lca(0, queries) == expected);
+    }
+
+    // Relabeling keeps the graph, up to renaming.
+    for (int t = 0; t < 50; ++t) {
+        int n = 1 + rand() % 50;
+        graph g(n);
+        for (int k = rand() % (3 * n); k > 0; --k)
+            g.edge(rand() % n, rand() % n);
+        for (auto o : {ordering::bfs, ordering::rcm, ordering::degree}) {
+            auto r = g.relabel(o);
+            vector<int> seen(n);
+            for (int x = 0; x < n; ++x) {
+                assert(r.backward[r.forward[x]] == x);
+                ++seen[r.forward[x]];
+                auto expected = g.adj[x];
+                for (auto& nbr : expected)
+                    nbr = r.forward[nbr];
+                sort(expected.begin(), expected.end());
+                assert(r.g.adj[r.forward[x]] == expected);
+            }
+            assert(count(seen.begin(), seen.end(), 1) == n);
+            assert(r.g.cc() == g.cc());
+        }
+    }
+
+    // RCM recovers a narrow band from a shuffled grid.
+    {
+        int w = 10, h = 30, n = w * h;
+        vector<int> id(n);
+        for (int i = 0; i < n; ++i)
+            id[i] = i;
+        for (int i = 1; i < n; ++i)
+            swap(id[i], id[rand() % (i + 1)]);
+        graph grid(n);
+        for (int i = 0; i < n; ++i) {
+            if (i % w + 1 < w) grid.edge(id[i], id[i + 1]);
+            if (i + w < n) grid.edge(id[i], id[i + w]);
+        }
+        auto bandwidth = [](const graph& g) {
+            int b = 0;
+            for (int x = 0; x < g.n; ++x)
+                for (auto nbr : g.adj[x])
+                    b = max(b, abs(x - nbr));
+            return b;
+        };
+        assert(bandwidth(grid) > 5 * w);
+        assert(bandwidth(grid.relabel(ordering::rcm).g) <= w + 1);
+        assert(bandwidth(grid.relabel(ordering::bfs).g) <= 4 * w);
+    }
+
+#ifdef BENCHMARK
+    benchmark(10000000, 100000000);
+    benchmark_locality(2000);
+#endif
+
     cout << "All tests passed" << endl;
     return 0;
 }